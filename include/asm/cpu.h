@@ -26,6 +26,38 @@
 
 #define ARM_THUMB_BRANCH_ADDR(x)                    ((x) | 0x1)
 #define ARM_CORTEX_M_CORE_EXC_NUM                   15
+#define ARM_CORTEX_M_EXC_SVC                        11
+#define ARM_CORTEX_M_EXC_PENDSV                     14
+#define ARM_CORTEX_M_EXC_SYSTICK                    15
+#define ARM_CORTEX_M_EXC_IRQ0                       16
+
+// Debug exception and monitor control / data watchpoint and trace unit.
+// See ARM DDI0403E C1.6.5 and C1.8.
+#define ARM_CORTEX_M_DEMCR_ADDR                     0xe000edfc
+#define ARM_CORTEX_M_DEMCR_TRCENA                   0x01000000
+#define ARM_CORTEX_M_DWT_CTRL_ADDR                  0xe0001000
+#define ARM_CORTEX_M_DWT_CTRL_CYCCNTENA             0x00000001
+#define ARM_CORTEX_M_DWT_CYCCNT_ADDR                0xe0001004
+
+// System control block and SysTick.  See ARM DDI0403E B3.2 and B3.3.
+#define ARM_CORTEX_M_ICSR_ADDR                      0xe000ed04
+#define ARM_CORTEX_M_ICSR_PENDSVSET                 0x10000000
+#define ARM_CORTEX_M_SHPR3_ADDR                     0xe000ed20
+#define ARM_CORTEX_M_SHPR3_PENDSV_SYSTICK_LOWEST    0xffff0000
+#define ARM_CORTEX_M_SYST_CSR_ADDR                  0xe000e010
+#define ARM_CORTEX_M_SYST_CSR_ENABLE                0x00000001
+#define ARM_CORTEX_M_SYST_CSR_TICKINT               0x00000002
+#define ARM_CORTEX_M_SYST_CSR_CLKSOURCE             0x00000004
+#define ARM_CORTEX_M_SYST_RVR_ADDR                  0xe000e014
+#define ARM_CORTEX_M_SYST_CVR_ADDR                  0xe000e018
+#define ARM_CORTEX_M_XPSR_T                         0x01000000
+#define ARM_CORTEX_M_EXC_RETURN_THREAD_PSP          0xfffffffd
+
+// NVIC set/clear enable and set pending, one bit per IRQ.  See ARM
+// DDI0403E B3.4.
+#define ARM_CORTEX_M_NVIC_ISER_ADDR                 0xe000e100
+#define ARM_CORTEX_M_NVIC_ICER_ADDR                 0xe000e180
+#define ARM_CORTEX_M_NVIC_ISPR_ADDR                 0xe000e200
 
 #define CONFIG_SRAM_SIZE                            20
 #define CONFIG_SRAM_BASE_ADDR                       0x20000000
@@ -45,14 +77,25 @@
 #define CPU_VEC_BASE                                CONFIG_FLASH_BASE_ADDR
 
 #define CPU_SWVEC_ALIGN                             4
+// Aligned without util.h ALIGN so this can be used from assembly.
 #define CPU_SWVEC_BASE \
-    ALIGN((CPU_VEC_BASE + CPU_VEC_SIZE), CPU_SWVEC_ALIGN)
+    (((CPU_VEC_BASE + CPU_VEC_SIZE) + (CPU_SWVEC_ALIGN - 1)) & \
+    ~(CPU_SWVEC_ALIGN - 1))
 #define CPU_SWVEC_ADDR(x) \
     ARM_THUMB_BRANCH_ADDR(CPU_SWVEC_BASE + ((x) * 8))
 
 #define CPU_SWVEC_COREDUMP                          0
 #define CPU_SWVEC_COREDUMP_ADDR \
     CPU_SWVEC_ADDR(CPU_SWVEC_COREDUMP)
+#define CPU_SWVEC_SVC                               1
+#define CPU_SWVEC_SVC_ADDR \
+    CPU_SWVEC_ADDR(CPU_SWVEC_SVC)
+#define CPU_SWVEC_PENDSV                            2
+#define CPU_SWVEC_PENDSV_ADDR \
+    CPU_SWVEC_ADDR(CPU_SWVEC_PENDSV)
+#define CPU_SWVEC_SYSTICK                           3
+#define CPU_SWVEC_SYSTICK_ADDR \
+    CPU_SWVEC_ADDR(CPU_SWVEC_SYSTICK)
 
 // memory vector format:
 // ldr pc, [pc]
@@ -61,6 +104,13 @@
 // See DDI0403E A2.3.1.
 // binary for insn: ldr pc, [pc]
 #define CPU_MEMVEC_JMP_INSN                         0xf000f8df
+// Memory vectors start at NMI (exception 2).
+#define CPU_MEMVEC_NUM \
+    (ARM_CORTEX_M_CORE_EXC_NUM - 1 + CONFIG_CPU_IRQ_NUM)
+#define CPU_MEMVEC_EXC_FIRST                        2
+
+// Size of each IRQ dispatch veneer in uld_irq_asm.S.
+#define CPU_IRQ_VENEER_SIZE                         24
 
 
 #endif  // _ASM_CPU_H
@@ -96,6 +96,30 @@
 #define __export
 #endif
 
+// Copied to RAM with the mem sections at load (see the .ramfunc output
+// section in the linker scripts).  Calls between flash and RAM code must
+// not be pc relative so both directions go through function descriptors.
+#ifdef __ramfunc
+#undef __ramfunc
+#endif
+#ifndef CONFIG_NO_ATTR_RAMFUNC
+#define __ramfunc __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define __ramfunc
+#endif
+
+// Constant pointer tables kept in flash.  Pointers to other modules are
+// written to flash by the loader the first time the file is linked and
+// again when a module they point to moves (see uld_dyn_store_rel_dst).
+#ifdef __flash_rel
+#undef __flash_rel
+#endif
+#ifndef CONFIG_NO_ATTR_FLASH_REL
+#define __flash_rel __attribute__((section(".flash_rel")))
+#else
+#define __flash_rel
+#endif
+
 #ifdef __format
 #undef __format
 #endif
@@ -44,6 +44,13 @@
                 "lr", "memory", "cc"); \
     } while (0)
 
+#ifdef ULD_HOST
+// Provided by the host simulation (see scripts/uld-prelink.c).
+uint32_t cpu_get_fb(void);
+uint32_t cpu_get_sp(void);
+uint32_t cpu_get_pc(void);
+uint32_t cpu_get_cycles(void);
+#else  // ULD_HOST
 static __inline __always_inline __notrace uint32_t cpu_get_fb(void)
 {
     uint32_t fd;
@@ -75,8 +82,26 @@ static __inline __always_inline __notrace uint32_t cpu_get_pc(void)
     return pc;
 }
 
+// Free running cycle counter (DWT_CYCCNT).  Targets without a DWT
+// (including QEMU) may always read 0.
+static __inline __always_inline __notrace uint32_t cpu_get_cycles(void)
+{
+    return *(volatile uint32_t *)ARM_CORTEX_M_DWT_CYCCNT_ADDR;
+}
+#endif  // ULD_HOST
+
+// Returns 1 if cpu_get_cycles counts.  Cycle counts are only printed when it
+// does.
+static __inline __always_inline __notrace int cpu_has_cycles(void)
+{
+    uint32_t start = cpu_get_cycles();
+
+    return cpu_get_cycles() != start;
+}
+
 void cpu_reset_clks(void);
 void cpu_init_clks(void);
+void cpu_init_cycle_counter(void);
 
 int cpu_flash_is_locked(void);
 int cpu_flash_unlock(void);
@@ -84,5 +109,10 @@ int cpu_flash_lock(void);
 int cpu_flash_erase(void *s, size_t n);
 int cpu_flash_write(void *dest, const void *src, size_t n);
 
+// Set handler for exception number exc_num (not IRQ number) in the memory
+// vector table.  Returns -1 if memory vectors are not used or exc_num is
+// out of range.
+int cpu_memvec_set(int exc_num, void (*handler)(void));
+
 
 #endif  // _CPU_H
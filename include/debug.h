@@ -24,6 +24,14 @@
 #define _DEBUG_H
 
 
+#ifdef ULD_HOST
+// Loader code built for the host (see scripts/uld-prelink.c) stops the
+// simulation instead.
+void uld_host_break(const char *file, int line);
+
+#define swbkpt() uld_host_break(__FILE__, __LINE__)
+#define undef_insn() uld_host_break(__FILE__, __LINE__)
+#else  // ULD_HOST
 // Software breakpoint.
 // This will always be one instruction and needed for uld-gdb.py commands to
 // step past it correctly.
@@ -38,6 +46,7 @@
     do { \
         asm volatile(".short 0xdeff\n"); \
     } while (0)
+#endif  // ULD_HOST
 
 
 #endif  // _DEBUG_H
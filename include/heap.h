@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _HEAP_H
+#define _HEAP_H
+
+
+#include "uld.h"
+
+
+// Arena allocator exported by libexc.so.  Blocks up to HEAP_CLASS_MAX bytes
+// are rounded up to a power of two size class and recycled through per
+// class free lists, larger blocks come straight from the bump arena.  Frees
+// are sized (callers keep the size as with uld_mem_free).  heap_reset
+// returns every block at once.
+#define HEAP_ALIGNMENT                              3
+#define HEAP_CLASS_MIN_SHIFT                        HEAP_ALIGNMENT
+#define HEAP_CLASS_COUNT                            6
+#define HEAP_CLASS_MAX \
+    (1 << (HEAP_CLASS_MIN_SHIFT + HEAP_CLASS_COUNT - 1))
+
+// Exported heap seeded by the loader (see uld_dyn_seed_heaps).
+#define HEAP_DEFAULT_SYM                            "heap_default"
+
+
+struct heap_block {
+    struct heap_block *next;
+};
+
+// caller is the return address of heap_alloc/heap_free and identifies the
+// calling module, size is the rounded size and alloc is 0 for frees.
+typedef void (*heap_account_f)(const void *caller, size_t size, int alloc);
+
+// NOTE: The loader writes base, end and ptr when seeding heap_default.
+struct heap {
+    uint8_t *base;
+    uint8_t *end;
+    uint8_t *ptr;
+    struct heap_block *free_list[HEAP_CLASS_COUNT];
+    heap_account_f account;
+};
+
+
+#ifndef __ULD__
+extern struct heap heap_default;
+
+// Use the size bytes at base as a new arena (e.g. carved from heap_default
+// for transient data that is released with heap_reset).
+void heap_init(struct heap *h, void *base, size_t size);
+void heap_reset(struct heap *h);
+
+// Returns NULL if the arena is exhausted.
+void *heap_alloc(struct heap *h, size_t size);
+// size must be the size passed to heap_alloc.
+void heap_free(struct heap *h, void *ptr, size_t size);
+
+// Bytes left in the bump arena (not counting blocks on the free lists).
+size_t heap_get_free_size(const struct heap *h);
+
+// Optional, NULL to disable.
+void heap_set_account(struct heap *h, heap_account_f account);
+#endif  // __ULD__
+
+
+#endif  // _HEAP_H
@@ -51,6 +51,18 @@ extern int uld_verbose;
 void uld_start_init(void);
 int uld_main(void);
 #else  // __ULD__
+// Stack size an executable needs, use once at file scope.  The size is
+// recorded in the fs table entry by gen-uld-files.py and the loader places
+// the stack with it (see uld_dyn_place_stack).
+#define ULD_STACK_SIZE(size) \
+    static const uint32_t __uld_stack_size \
+    __attribute__((section(".uld_stack"), used)) = (size)
+// Cap on the heap_default arena (see heap.h) the loader seeds for the
+// executable's program, use once at file scope.  Without it the arena gets
+// its share of the largest free region (see uld_dyn_seed_heaps).
+#define ULD_HEAP_SIZE(size) \
+    static const uint32_t __uld_heap_size \
+    __attribute__((section(".uld_heap"), used)) = (size)
 #endif  // __ULD__
 
 
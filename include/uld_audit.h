@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+#ifndef _ULD_AUDIT_H
+#define _ULD_AUDIT_H
+
+
+#include "uld.h"
+
+
+// Binding audit (ULD_AUDIT).  The dynamic linker calls each non-NULL
+// callback in uld_audit_ops as files are loaded, relocations bound, function
+// descriptors allocated and constructors run.  Callbacks run in the loader
+// (handler mode for runtime services) and must not call back into uld_dyn.
+struct uld_audit_ops {
+    // ufile was loaded, called before linking.
+    void (*file_loaded)(const struct uld_file *ufile);
+    // A relocation of rel_type in req was bound to name in prov (prov may
+    // be req).  lookups is the number of hash table lookups it cost.
+    void (*sym_bound)(const struct uld_file *req, const struct uld_file *prov,
+            const char *name, unsigned int rel_type, int lookups);
+    // An 8 byte function descriptor for prov was allocated at fd in the
+    // dl_alloc pool of req.
+    void (*funcdesc_alloc)(const struct uld_file *req,
+            const struct uld_file *prov, const void *fd);
+    // Constructors of ufile were run.
+    void (*init_run)(const struct uld_file *ufile, uint32_t cycles);
+};
+
+// In-tree consumer aggregating binding statistics for gdb (`uld audit`).
+// Files are tracked by fs entry since ufile_list indexes change when files
+// are released.  bind[r][p] counts relocations of file r bound to file p.
+#define ULD_AUDIT_FILE_MAX                          8
+#define ULD_AUDIT_REL_TYPE_MAX                      4
+#define ULD_AUDIT_REL_IDX_ABS32                     0
+#define ULD_AUDIT_REL_IDX_GLOB_DAT                  1
+#define ULD_AUDIT_REL_IDX_FUNCDESC                  2
+#define ULD_AUDIT_REL_IDX_FUNCDESC_VALUE            3
+
+struct uld_audit_bind {
+    uint16_t count;
+    uint16_t lookups;
+};
+
+struct uld_audit_file {
+    const struct uld_fs_entry *fse;
+    uint16_t load_count;
+    uint16_t funcdesc_count;
+    uint32_t init_cycles;
+};
+
+struct uld_audit_stats {
+    struct uld_audit_file file[ULD_AUDIT_FILE_MAX];
+    struct uld_audit_bind bind[ULD_AUDIT_FILE_MAX][ULD_AUDIT_FILE_MAX];
+    uint32_t rel_count[ULD_AUDIT_REL_TYPE_MAX];
+    uint32_t lookups;
+    // Most expensive binding seen.  Name is in the requester's .dynstr.
+    const char *max_lookups_name;
+    int max_lookups;
+    int dropped;
+};
+
+
+#ifdef ULD_AUDIT
+extern const struct uld_audit_ops *uld_audit_ops;
+extern struct uld_audit_stats uld_audit_stats;
+extern const struct uld_audit_ops uld_audit_stats_ops;
+
+// Install ops (NULL to disable).
+void uld_audit_set_ops(const struct uld_audit_ops *ops);
+// Clear uld_audit_stats and install uld_audit_stats_ops.
+void uld_audit_init(void);
+
+#define uld_audit(op, ...) \
+    do { \
+        if (uld_audit_ops && uld_audit_ops->op) { \
+            uld_audit_ops->op(__VA_ARGS__); \
+        } \
+    } while (0)
+#else  // ULD_AUDIT
+#define uld_audit_set_ops(ops)
+#define uld_audit_init()
+#define uld_audit(op, ...)
+#endif  // ULD_AUDIT
+
+
+#endif  // _ULD_AUDIT_H
@@ -37,6 +37,78 @@
      ULD_SECTION_FLAG_TYPE_MEM | \
      ULD_SECTION_FLAG_TYPE_DYNAMIC)
 
+// Limits for the loaded module state kept after control is passed to the
+// executable.  Sections are only the loaded types (see above).
+// ULD_DYN_FILE_MAX must fit in uld_file.res_mask.
+#define ULD_DYN_FILE_MAX                            8
+#define ULD_DYN_SECTION_MAX                         80
+#define ULD_DYN_DLSYM_FUNCDESC_MAX                  16
+#define ULD_DYN_LAZY_FILE_MAX                       4
+#define ULD_DYN_LAZY_IMPORT_MAX                     32
+#define ULD_DYN_PROGRAM_MAX                         4
+#define ULD_DYN_OVERLAY_MAX                         7
+// RAM left free after seeding heap_default arenas (see heap.h) for
+// uld_dlopen, lazy and overlay loads.
+#define ULD_DYN_HEAP_KEEP                           0x800
+// Section holding the heap size an executable declares.
+// NOTE: Keep in sync with ULD_HEAP_SIZE in uld.h.
+#define ULD_DYN_HEAP_SEC_NAME                       ".uld_heap"
+
+// Function descriptors handed out by uld_dyn_dlsym.  These can not be
+// placed in the dl_alloc pool since it may be released by a file that
+// does not contain the function.
+struct uld_dyn_funcdesc {
+    const void *fp;
+    const void *fb;
+};
+
+// Function import from a library marked ULD_FS_ENTRY_FLAG_LAZY that has not
+// been loaded.  slot is the function descriptor set to uld_dyn_lazy_stub and
+// this struct (as pic base) until fse is loaded and linked.  name is in the
+// importer's .dynstr.  Free when fse is NULL.
+struct uld_dyn_lazy_import {
+    void **slot;
+    const struct uld_fs_entry *fse;
+    const struct uld_fs_entry *importer;
+    const char *name;
+    int instance;
+};
+
+// RAM window shared by the members of an overlay group, sized for the
+// largest member and allocated on first use.  active is the member loaded
+// in the window or NULL.
+struct uld_dyn_overlay {
+    uint8_t *base;
+    size_t size;
+    const struct uld_fs_entry *active;
+};
+
+// Loaded module state.  ufile_list is in load order (dependencies first)
+// and each file's sections are contiguous in sec_list in the same order.
+// Files loaded at boot are never released.  Releasing a file compacts both
+// lists.
+struct uld_dyn_state {
+    struct uld_file ufile_list[ULD_DYN_FILE_MAX];
+    struct uld_section sec_list[ULD_DYN_SECTION_MAX];
+    struct uld_dyn_funcdesc dlsym_fd[ULD_DYN_DLSYM_FUNCDESC_MAX];
+    const struct uld_fs_entry *lazy_fse[ULD_DYN_LAZY_FILE_MAX];
+    struct uld_dyn_lazy_import lazy_import[ULD_DYN_LAZY_IMPORT_MAX];
+    struct uld_dyn_overlay overlay[ULD_DYN_OVERLAY_MAX];
+    int lazy_count;
+    int file_count;
+    int sec_count;
+    int exec_idx;
+    // Program instance runtime services and newly loaded files apply to.
+    int instance;
+    int program_count;
+    // Stack placed for the executable's declared size, not set if the
+    // executable does not declare one or reuses the loader stack.
+    uint8_t *stack_base;
+    size_t stack_size;
+};
+
+extern struct uld_dyn_state uld_dyn_state;
+
 
 unsigned long uld_dyn_elf_hash(const unsigned char *name);
 
@@ -65,20 +137,115 @@ int uld_dyn_get_fse_dep_count(const struct uld_fs_entry *fse);
 int uld_dyn_get_dep_list_sec_count(const struct uld_fs_entry **dep_list,
         int dep_count, uint32_t type_mask);
 
-// membase r/w, membase may be moved for alignment. Allocated (w/o) is the size
-// from the possibly updated membase and includes padding in between files.
-// ufile_list[x].membase should be used directly as the base for each file's
-// memory space.
+// ufile_list[x].membase is allocated for each file with mem sections (see
+// uld_load_file).  On error all membases allocated are freed.
 int uld_dyn_load_fse_dep_list(const struct uld_fs_entry **dep_list,
         int dep_count, struct uld_file *ufile_list,
-        struct uld_section *sec_list, int sec_count, uint8_t **membase,
-        size_t *allocated);
-
-int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
-        uint8_t *dl_alloc_base, size_t *dl_alloc_size);
-
+        struct uld_section *sec_list, int sec_count);
+
+// Link files [first_idx, file_count) in ufile_list.  Files before first_idx
+// must already be linked and are only searched for resolutions.
+// dl_alloc_max bytes are available at dl_alloc_base, linking fails before
+// allocating past them.  dl_alloc_size (w/o) is the number of bytes used
+// from dl_alloc_base, the part used by each file and its resolution records
+// are set in ufile_list.
+int uld_dyn_link_file_list_from(struct uld_file *ufile_list,
+        int first_idx, int file_count, uint8_t *dl_alloc_base,
+        size_t dl_alloc_max, size_t *dl_alloc_size);
+int uld_dyn_link_file_list(struct uld_file *ufile_list, int file_count,
+        uint8_t *dl_alloc_base, size_t dl_alloc_max, size_t *dl_alloc_size);
+
+// Libraries marked ULD_FS_ENTRY_FLAG_LAZY (and dependencies only they
+// require) are not loaded before entry.  Function imports from them are bound
+// to uld_dyn_lazy_stub, other imports from a lazy library are a link error.
 int uld_dyn_exec_fse(const struct uld_fs_entry *fse, void *sp_base, int argc,
         const char **argv);
+// Load each executable in fse_list as a separate program instance then run
+// them concurrently with uld_sched until all return from entry.  Libraries
+// needed by more than one program share flash but each program gets its own
+// instance (membase, GOT and dl_alloc pool) and stack.
+int uld_dyn_exec_fse_list(const struct uld_fs_entry **fse_list, int count,
+        int argc, const char **argv);
+// Run fse after the executable started by uld_dyn_exec_fse (or a previous
+// chain) has returned.  The previous executable's .fini_array is run and its
+// memory freed.  Libraries fse also needs stay loaded and linked, the rest
+// are unloaded.  The stack must not have been reset by the previous
+// executable.  Not supported after uld_dyn_exec_fse_list.
+int uld_dyn_chain_fse(const struct uld_fs_entry *fse, int argc,
+        const char **argv);
+
+// Reserve module memory (membase, dl_alloc pool, heap and .data image) of a
+// file list restored from a snapshot or retained RAM, and the overlay
+// windows in uld_dyn_state.  On error the allocator is reset and -1
+// returned.
+int uld_dyn_reserve_file_list(const struct uld_file *ufile_list,
+        int file_count);
+// Zero the objects allocated in the dl_alloc pool for GLOB_DAT relocations
+// of loaded file_idx (see uld_dyn_write_reso_glob_dat).  Used when .data and
+// .bss are reset without linking again (warm reset).
+void uld_dyn_zero_dl_objects(int file_idx);
+// Relink file_idx of a restored file list after its fs entry changed (see
+// uld_flat_restore).  The file is loaded again in its section slots and
+// membase and its own imports are bound.  Of the later files only those
+// whose resolution records point into it, or into an importer whose GOT
+// changed, are resolved again and only their relocations into those files
+// are written.  Other GOT contents are kept.  Returns -1 if the file no
+// longer fits or needs other files, or if an import bound into those files
+// no longer resolves to one of them.  The caller must then reset the
+// allocator and link from scratch.
+int uld_dyn_relink_file(int file_idx);
+
+// Called from uld_dyn_lazy_stub (uld_dyn_asm.S) on the first call through
+// import.  Loads and links import->fse, binds every import from it and
+// returns the bound function descriptor.
+const void *uld_dyn_lazy_bind(struct uld_dyn_lazy_import *import);
+void uld_dyn_lazy_stub(void);
+
+// Runtime services (see uld_svc.h).  These extend the set loaded by
+// uld_dyn_exec_fse and return NULL or -1 on error.
+// The handle returned by uld_dyn_dlopen is the file's fs entry since
+// struct uld_file entries move when other files are released.
+// NULL handle passed to uld_dyn_dlsym searches all loaded files.
+// uld_dyn_dlclose drops one handle returned by uld_dyn_dlopen, -1 is
+// returned for files that were not opened.  It runs .fini_array and frees
+// memory for each file no longer referenced by a handle or the resolution
+// records of another file.  Files loaded at boot (ULD_FILE_FLAG_BOOT) are
+// never released.
+void *uld_dyn_dlopen(const char *name);
+// Run constructors deferred by ULD_FS_ENTRY_FLAG_DEFER_INIT for a loaded
+// file and its dependencies.  Constructors run once, this may be called
+// again.  Lazy binding and uld_dyn_dlopen also run deferred constructors.
+int uld_dyn_module_init(const char *name);
+// Replace loaded library old_name with new_name.  new_name and any missing
+// dependencies are loaded and initialized, then its optional migration hook
+// (ULD_SWAP_MIGRATE_SYM) is called.  Every importer recorded in the
+// resolution records has its GOT entries into old_name repointed, as do
+// uld_dyn_dlsym descriptors and exported IRQ handlers (uld_irq.h).
+// old_name is then freed without running its .fini_array since its state
+// was handed over.  Handles to old_name are no longer valid.
+int uld_dyn_swap(const char *old_name, const char *new_name);
+// Load patch module patch_name and redirect each function it defines that
+// loaded library target_name also defines.  Function descriptors equal to
+// the target function (the target's canonical descriptors, importers'
+// .got/.got.plt entries, uld_dyn_dlsym descriptors and IRQ handlers) are
+// rewritten to the patch function with the patch module's membase.  Direct
+// calls inside the target are not patched.  Files linked later resolve
+// against the patch module first since it is searched before the target.
+int uld_dyn_patch(const char *patch_name, const char *target_name);
+// Make overlay member name active in its group's window.  Overlay members
+// (ULD_FS_ENTRY_FLAG_OVERLAY_MASK) are handled like lazy libraries: they are
+// never bound directly, function imports from them go through
+// uld_dyn_lazy_stub.  Activating a member first evicts the active member of
+// the group: its .fini_array is run, its imports are reset to the stub and
+// dependencies only it needed are released.  The member is then loaded into
+// the window (.data copied, .bss zeroed and mem fixups applied), initialized
+// and every import from it is bound.  A call through an import of an
+// inactive member activates it.  Members may only export functions and must
+// not be running or on the stack when evicted, so members of a group must
+// not call each other.  Returns 0 on success or -1 on error.
+int uld_dyn_overlay(const char *name);
+void *uld_dyn_dlsym(void *handle, const char *name);
+int uld_dyn_dlclose(void *handle);
 
 
 #define uld_dyn_get_sym_name(sym, dynstr_sec) \
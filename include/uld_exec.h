@@ -33,13 +33,19 @@ void uld_exec_call_vv_fp_array(void (**arr_start)(void),
 void uld_exec_call_vv_fp_array_fdpic_base(void (**arr_start)(void),
         void (**arr_end)(void), uint32_t fdpic_base);
 
+void uld_exec_call_vv_fp_array_rev_fdpic_base(void (**arr_start)(void),
+        void (**arr_end)(void), uint32_t fdpic_base);
+
 int uld_exec_elf_call_init_funcs(struct uld_file *ufile);
+int uld_exec_elf_call_fini_funcs(struct uld_file *ufile);
 
 int uld_exec_file(const struct uld_file *ufile, void *sp_base, int argc,
         const char **argv);
 
 // Functions in uld_exec_asm.S
 void uld_exec_call_vv_fp_fdpic_base(void (*fp)(void), uint32_t fdpic_base);
+void uld_exec_call_vp_fp_fdpic_base(void (*fp)(void *), void *arg,
+        uint32_t fdpic_base);
 
 // Note: argv and contents will be copied to sp_base before stack reset.
 // If this overwrites the working stack it may cause unpredictable
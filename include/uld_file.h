@@ -70,17 +70,31 @@ ULD_FILE_GET_SEC_FUNC(plt,          ".plt",         FLASH)
 ULD_FILE_GET_SEC_FUNC(rofixup,      ".rofixup",     FLASH)
 ULD_FILE_GET_SEC_FUNC(got,          ".got",         MEM)
 ULD_FILE_GET_SEC_FUNC(got_plt,      ".got.plt",     MEM)
+ULD_FILE_GET_SEC_FUNC(data,         ".data",        MEM)
+ULD_FILE_GET_SEC_FUNC(ramfunc,      ".ramfunc",     MEM)
+ULD_FILE_GET_SEC_FUNC(bss,          ".bss",         MEM)
 ULD_FILE_GET_SEC_FUNC(hash,         ".hash",        DYNAMIC)
 ULD_FILE_GET_SEC_FUNC(dynsym,       ".dynsym",      DYNAMIC)
 ULD_FILE_GET_SEC_FUNC(dynstr,       ".dynstr",      DYNAMIC)
 ULD_FILE_GET_SEC_FUNC(dynamic,      ".dynamic",     DYNAMIC)
 ULD_FILE_GET_SEC_FUNC(rel_dyn,      ".rel.dyn",     DYNAMIC)
 
+static __inline __always_inline __notrace size_t uld_file_get_data_size(
+        const struct uld_file *ufile)
+{
+    const struct uld_section *data = uld_file_get_sec_data(ufile);
+
+    return data ? data->shdr->sh_size : 0;
+}
+
 
 const void *uld_file_lma_to_adjusted_lma(const struct uld_file *ufile,
         const void *lma);
 const void *uld_file_lma_to_adjusted_vma(const struct uld_file *ufile,
         const void *lma);
 
+// Entry point following the RAM copy of the text if present.
+const void *uld_file_get_adjusted_entry(const struct uld_file *ufile);
+
 
 #endif  // _ULD_FILE_H
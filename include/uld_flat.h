@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_FLAT_H
+#define _ULD_FLAT_H
+
+
+#include "uld.h"
+#include "uld_dyn.h"
+#include "uld_reloc.h"
+
+
+// Prelinked image of the module set of an executable marked
+// ULD_FS_ENTRY_FLAG_FLAT kept in the ULD_FLAT flash area (see linker
+// script).  It is saved after linking, before constructors, and is valid
+// while no file in the set changed, moved or had its descriptor table
+// rebuilt.  If only one did, that file is relinked on the restored state
+// (see uld_dyn_relink_file) and the image saved again.
+#define ULD_FLAT_MAGIC                              0x54414c46
+
+// Linker defined symbols.
+extern uint8_t _s_uld_flat;
+extern uint8_t _uld_flat_size;
+#define ULD_FLAT_BASE                               (&_s_uld_flat)
+#define ULD_FLAT_SIZE                               ((size_t)&_uld_flat_size)
+
+
+struct uld_flat_file {
+    const struct uld_fs_entry *fse;
+    const void *base;
+    uint32_t crc;
+    const struct uld_reloc_fdtab *fdtab;
+};
+
+// Followed by the loaded file and section lists, the rest of uld_dyn_state
+// from dlsym_fd and, for each file, the initialized part of its memory and
+// its dl_alloc pool.  Each part is padded to 4 bytes.  crc covers the size
+// bytes following the header.
+struct uld_flat_hdr {
+    uint32_t magic;
+    uint32_t crc;
+    const struct uld_fs_entry *exec_fse;
+    const void *state;
+    size_t state_size;
+    // crc of the preload and memory placement settings in ULD_PSTORE.
+    uint32_t pstore_crc;
+    size_t size;
+    int file_count;
+    int sec_count;
+    struct uld_flat_file file[ULD_DYN_FILE_MAX];
+};
+
+
+// Save the linked module set of uld_dyn_state before constructors run.
+// Files with RAM text or in an overlay group can not be flattened.
+int uld_flat_save(void);
+
+// Restore the linked module set of exec_fse: loader state, the initialized
+// part of module memory and dl_alloc pools are copied and .bss is zeroed.
+// Returns 0 if restored, constructors have to be run.  Must be called
+// before any module memory is allocated.
+int uld_flat_restore(const struct uld_fs_entry *exec_fse);
+
+
+#endif  // _ULD_FLAT_H
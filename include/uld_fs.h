@@ -30,6 +30,16 @@
 #define uld_fs_get_fst_head() \
     (ULD_PSTORE->fs_table_pri.head)
 
+// Overlay group of fse or 0.
+#define uld_fs_get_overlay(fse) \
+    ((unsigned int)(((fse)->flags & ULD_FS_ENTRY_FLAG_OVERLAY_MASK) >> \
+    ULD_FS_ENTRY_FLAG_OVERLAY_SHIFT))
+
+// Declared stack size of fse in bytes or 0.
+#define uld_fs_get_stack_size(fse) \
+    ((size_t)(((fse)->flags & ULD_FS_ENTRY_FLAG_STACK_MASK) >> \
+    ULD_FS_ENTRY_FLAG_STACK_SHIFT) * 8)
+
 #define fst_for_each_entry(pos, head) \
     for ((pos) = (head); (pos) != NULL; (pos) = (pos)->next)
 
@@ -40,6 +50,9 @@ const struct uld_fs_entry *uld_fs_get_file_by_index(
         const struct uld_fs_entry *head, int index);
 const struct uld_fs_entry *uld_fs_get_file_by_name(
         const struct uld_fs_entry *head, const char *name);
+// Returns 1 if fse is an entry in the table at head.
+int uld_fs_has_file(const struct uld_fs_entry *head,
+        const struct uld_fs_entry *fse);
 
 const void *uld_fs_find_free_space(struct uld_pstore *pstore, size_t size);
 
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+#ifndef _ULD_IRQ_H
+#define _ULD_IRQ_H
+
+
+#include "uld.h"
+
+
+// IRQ dispatch into FDPIC modules.  A registered IRQ's memory vector points
+// to its veneer in uld_irq_asm.S which saves r9, loads fp/fb from
+// uld_irq_table and calls the handler with the module's r9.  The added
+// latency (uld_irq_latency) is measured at init.  Requires memory vectors
+// (CONFIG_CPU_VEC_IN_MEM).
+struct uld_irq_entry {
+    const void *fp;
+    const void *fb;
+};
+
+extern struct uld_irq_entry uld_irq_table[CONFIG_CPU_IRQ_NUM];
+// Worst case cycles a veneer adds over calling the handler directly.
+extern uint32_t uld_irq_latency;
+
+void uld_irq_init(void);
+
+// Dispatch irq to the function descriptor funcdesc and enable it in the
+// NVIC.  NULL funcdesc disables irq and restores the default vector.
+// Returns 0 on success or -1 on error.
+int uld_irq_register(int irq, const void *funcdesc);
+
+// Unregister IRQs handled by ufile, called before it is unloaded.
+void uld_irq_release(const struct uld_file *ufile);
+
+// Functions in uld_irq_asm.S
+void uld_irq_veneers(void);
+
+
+#endif  // _ULD_IRQ_H
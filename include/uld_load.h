@@ -68,7 +68,8 @@ static __inline __always_inline __notrace int uld_load_create_other_sec_list(
             ULD_SECTION_FLAG_TYPE_OTHER);
 }
 
-uint8_t *uld_load_get_next_membase(uint8_t *last_membase, size_t last_memsize);
+// Memory required for a file's mem sections (aligned).
+size_t uld_load_get_mem_size(const struct uld_section *mem_list, int mnum);
 
 int uld_load_alloc_mem_sections(const struct elf32_ehdr *ehdr,
         const void *base, uint8_t *membase, size_t *allocated,
@@ -78,14 +79,23 @@ int uld_load_create_file(const struct uld_fs_entry *fse,
         struct uld_section *sec_list, int snum, uint32_t type_mask,
         struct uld_file *ufile);
 
-// On call membase/allocated should hold the last base/allocated values set by
-// uld_load_file.  On the first call use ptr/0 to start allocation at a
-// specific address or NULL/0 to initialize values directly after uld memory
-// space.  The original value of membase may be modified for alignment
-// constraints.
+// Memory required for fse's mem sections without loading it.
+size_t uld_load_get_fse_mem_size(const struct uld_fs_entry *fse);
+
+// ufile->membase/memsz are allocated with uld_mem_alloc if the file has mem
+// sections.  On error the caller must free ufile->membase if set.
+// Executable sections of ULD_FS_ENTRY_FLAG_RAM files are also copied to
+// ufile->text_image (freed with uld_load_free_text).
 int uld_load_file(const struct uld_fs_entry *fse,
         struct uld_section *sec_list, int snum, uint32_t type_mask,
-        uint8_t **membase, size_t *allocated, struct uld_file *ufile);
+        struct uld_file *ufile);
+// Same as uld_load_file but mem sections are placed at membase if not NULL,
+// which must have room for uld_load_get_fse_mem_size bytes.  The caller
+// owns membase.
+int uld_load_file_at(const struct uld_fs_entry *fse,
+        struct uld_section *sec_list, int snum, uint32_t type_mask,
+        uint8_t *membase, struct uld_file *ufile);
+void uld_load_free_text(struct uld_file *ufile);
 
 
 #endif  // _ULD_LOAD_H
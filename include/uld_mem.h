@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_MEM_H
+#define _ULD_MEM_H
+
+
+#include "uld.h"
+
+
+// Loaded module memory is allocated from a free region table built from the
+// RAM bank table in the linker script (.uld_mem_banks) less the loader's RAM
+// and the stack reserve below ESTACK.  The table only tracks free memory,
+// callers must keep the size of each allocation to free it.
+#define ULD_MEM_REGION_MAX                          16
+#define ULD_MEM_ALIGNMENT                           3
+#define ULD_MEM_STACK_SIZE                          0x1000
+
+// Placement policy when a module is not pinned to a bank (pstore mem_policy).
+#define ULD_MEM_POLICY_FIRST_FIT                    0
+#define ULD_MEM_POLICY_BEST_FIT                     1
+
+#define ULD_MEM_BANK_ANY                            -1
+
+// Pstore placement names for the dl_alloc pool, heap arenas and the
+// executable's stack.
+#define ULD_MEM_PLACE_DL_ALLOC                      "dl_alloc"
+#define ULD_MEM_PLACE_HEAP                          "heap"
+#define ULD_MEM_PLACE_STACK                         "stack"
+
+
+struct uld_mem_region {
+    uint8_t *base;
+    size_t size;
+};
+
+// NOTE: If changing this structure update .uld_mem_banks in the linker script.
+struct uld_mem_bank {
+    uint8_t *base;
+    size_t size;
+};
+
+extern const struct uld_mem_bank _s_uld_mem_banks[];
+extern const struct uld_mem_bank _e_uld_mem_banks[];
+
+#define uld_mem_get_bank_count() \
+    ((int)(_e_uld_mem_banks - _s_uld_mem_banks))
+
+
+void uld_mem_init(void);
+
+// Allocate from bank (ULD_MEM_BANK_ANY for all banks) using policy, returns
+// NULL if no region is large enough.
+void *uld_mem_alloc_in(size_t size, int bank, uint32_t policy);
+// Default policy from the pstore, any bank.
+void *uld_mem_alloc(size_t size);
+// Bank pinned by the pstore placement list for name, default policy.
+void *uld_mem_alloc_for(const char *name, size_t size);
+// Ranges do not have to match an allocation but must not be free.
+int uld_mem_free(void *ptr, size_t size);
+
+// For allocations of unknown size (dl_alloc pool).  Returns the base of the
+// largest free region in bank, use uld_mem_reserve to claim the used part.
+void *uld_mem_get_largest_in(int bank, size_t *size);
+#define uld_mem_get_largest(size) \
+    uld_mem_get_largest_in(ULD_MEM_BANK_ANY, (size))
+int uld_mem_reserve(void *ptr, size_t size);
+
+// Bank pinned for name in the pstore placement list or ULD_MEM_BANK_ANY.
+int uld_mem_get_place(const char *name);
+// Bank containing ptr or ULD_MEM_BANK_ANY.
+int uld_mem_find_bank(const void *ptr);
+
+// Free regions sorted by base.
+const struct uld_mem_region *uld_mem_get_free_list(int *count);
+size_t uld_mem_get_free_size(void);
+size_t uld_mem_get_bank_free_size(int bank);
+
+int uld_fprint_mem(FILE *stream);
+#define uld_print_mem() \
+    uld_fprint_mem(stdout)
+
+
+#endif  // _ULD_MEM_H
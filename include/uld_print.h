@@ -46,6 +46,9 @@ int uld_fprint_dyn(FILE *stream, const struct uld_file *ufile, int all);
 int uld_fprint_dynsym(FILE *stream, const struct uld_file *ufile);
 int uld_fprint_rel_dyn(FILE *stream, const struct uld_file *ufile);
 
+// Loader, module, overlay and free ranges of each RAM bank sorted by address.
+int uld_fprint_mem_map(FILE *stream);
+
 
 #define uld_print_fse_file(ufile) \
     uld_fprint_fse_file(stdout, (ufile))
@@ -77,5 +80,8 @@ int uld_fprint_rel_dyn(FILE *stream, const struct uld_file *ufile);
 #define uld_print_rel_dyn(ufile) \
     uld_fprint_rel_dyn(stdout, (ufile))
 
+#define uld_print_mem_map() \
+    uld_fprint_mem_map(stdout)
+
 
 #endif  // _ULD_PRINT_H
@@ -25,9 +25,72 @@
 
 
 #include "uld.h"
+#include "uld_dyn.h"
+
+
+// Function descriptor tables of files marked ULD_FS_ENTRY_FLAG_FDTAB are
+// appended to the ULD_FDTAB flash area (see linker script).  The last table
+// of a file is current, it is valid while the file's flash address, membase
+// and crc match the ones it was built for.  Bind stamps of files with
+// relocations in flash sections are kept in the same area.
+#define ULD_RELOC_FDTAB_MAGIC                       0x42544446
+#define ULD_RELOC_STAMP_MAGIC                       0x504d5453
+
+// Linker defined symbols.
+extern uint8_t _s_uld_fdtab;
+extern uint8_t _uld_fdtab_size;
+#define ULD_RELOC_FDTAB_BASE                        (&_s_uld_fdtab)
+#define ULD_RELOC_FDTAB_SIZE                        ((size_t)&_uld_fdtab_size)
+
+
+// Followed by count descriptors, one for each function in .dynsym.  Bind
+// stamps have no descriptors.
+struct uld_reloc_fdtab {
+    uint32_t magic;
+    const struct uld_fs_entry *fse;
+    const void *file_base;
+    union {
+        uint8_t *membase;
+        uint32_t stamp;
+    };
+    // fse->crc the table was built for, unused by bind stamps.
+    uint32_t crc;
+    uint32_t count;
+};
 
 
 int uld_reloc_move_fse(const struct uld_fs_entry *fse, const void *new_base);
 
+// Current table of fse or NULL.
+const struct uld_reloc_fdtab *uld_reloc_find_fdtab(
+        const struct uld_fs_entry *fse);
+// Current table of loaded ufile if valid for its flash address, membase and
+// crc, otherwise NULL.
+const struct uld_reloc_fdtab *uld_reloc_get_fdtab(
+        const struct uld_file *ufile);
+// Flash descriptor of the function at fp (adjusted vma) in loaded ufile if
+// ufile has a valid table, otherwise NULL.
+const struct uld_dyn_funcdesc *uld_reloc_get_fdtab_funcdesc(
+        const struct uld_file *ufile, const void *fp);
+// Build tables for loaded files marked ULD_FS_ENTRY_FLAG_FDTAB that have no
+// valid table.  Called before linking so importers use them.
+int uld_reloc_update_fdtab(const struct uld_file *ufile_list, int file_count);
+
+// Returns 1 if the relocations in flash sections of fse were bound with
+// stamp at its current flash address.  The fdtab area is then in use and
+// is not erased.
+int uld_reloc_check_stamp(const struct uld_fs_entry *fse, uint32_t stamp);
+int uld_reloc_set_stamp(const struct uld_fs_entry *fse, uint32_t stamp);
+
+#ifdef ULD_PLT_VENEER
+// Rewrite PLT entries in flash to direct veneers (fdpic base and target as
+// literals) for imports from files with a valid descriptor table and back
+// to PLT entries for the others.  Call after the .got.plt slots of the
+// loaded files change and before the importers run.
+int uld_reloc_update_plt(const struct uld_file *ufile_list, int file_count);
+#else  // ULD_PLT_VENEER
+#define uld_reloc_update_plt(ufile_list, file_count)
+#endif  // ULD_PLT_VENEER
+
 
 #endif  // _ULD_RELOC_H
@@ -35,5 +35,11 @@ int uld_rofixup_apply_mem_fixups(const struct elf32_ehdr *ehdr,
         const void *base, struct uld_section *flash_list, int fnum,
         struct uld_section *mem_list, int mnum, uint32_t membase);
 
+// Move pointers in loaded mem sections that target [from, from + size)
+// (adjusted flash addresses) to the same offset from to.
+int uld_rofixup_apply_ram_fixups(const struct elf32_ehdr *ehdr,
+        const void *base, struct uld_section *mem_list, int mnum,
+        const void *from, size_t size, void *to);
+
 
 #endif  // _ULD_ROFIXUP_H
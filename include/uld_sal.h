@@ -36,8 +36,13 @@ uint32_t uld_crc_calc_fse(const struct uld_fs_entry *fse);
 int uld_crc_verify_fse(const struct uld_fs_entry *fse, uint32_t *crc);
 int uld_crc_update_fse(struct uld_fs_entry *fse, uint32_t *crc);
 
+// crc of the pstore settings that change what is loaded and where
+// (preload, mem_policy and mem_place).  Saved module sets are only valid
+// while it matches.
+uint32_t uld_crc_calc_pstore(void);
 
-#define ULD_SECTION_MEM_NAME_LIST_COUNT             4
+
+#define ULD_SECTION_MEM_NAME_LIST_COUNT             5
 #define ULD_SECTION_MEM_NAME_MAX ULD_LOAD_MEM_SECTION_LIST_COUNT
 
 #define ULD_SECTION_MEM_NAME_FIXUP_LIST_COUNT       3
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_SCHED_H
+#define _ULD_SCHED_H
+
+
+#include "uld.h"
+
+
+// Preemptive round robin scheduler for programs loaded by
+// uld_dyn_exec_fse_list.  Each program runs in thread mode on its own
+// process stack (psp).  SysTick pends PendSV which saves r4-r11 (including
+// the program's r9 FDPIC base) on the running stack and restores the next.
+// uld itself is the idle context on msp and resumes once every program has
+// returned from entry.
+#define ULD_SCHED_TASK_MAX                          4
+// Default task stack for programs that do not declare one (ULD_STACK_SIZE).
+#define ULD_SCHED_STACK_SIZE                        0x400
+// SysTick reload in core clocks (10ms at the 8MHz HSI).
+#define ULD_SCHED_TICK_CYCLES                       80000
+
+#define ULD_SCHED_TASK_STATE_FREE                   0
+#define ULD_SCHED_TASK_STATE_READY                  1
+#define ULD_SCHED_TASK_STATE_DONE                   2
+
+
+struct uld_sched_task {
+    uint32_t *sp;
+    uint8_t *stack_base;
+    size_t stack_size;
+    int instance;
+    int state;
+};
+
+
+void uld_sched_init(void);
+
+// Create a task for a program entry point.  The initial exception frame is
+// built at the top of stack_base so the first switch starts entry(argc, argv)
+// with r9 set to fdpic_base.  Returns the task index or -1.
+int uld_sched_add_task(const void *entry, uint32_t fdpic_base, int instance,
+        uint8_t *stack_base, size_t stack_size, int argc, const char **argv);
+
+// Start SysTick and run tasks until all have returned, then remove them.
+void uld_sched_run(void);
+
+// Prevent or allow task switches while uld state is changed from thread
+// mode (lazy binding).  Calls nest.
+void uld_sched_lock(void);
+void uld_sched_unlock(void);
+
+// Called from uld_sched_pendsv with the saved context of the running task
+// (or uld), returns the context to restore.
+uint32_t *uld_sched_switch(uint32_t *sp);
+// Called from uld_sched_task_return in thread mode when entry returns.
+void uld_sched_task_exit(int ret);
+
+// Functions in uld_sched_asm.S
+void uld_sched_pendsv(void);
+void uld_sched_task_return(void);
+
+void uld_sched_systick(void);
+
+
+#endif  // _ULD_SCHED_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_SNAP_H
+#define _ULD_SNAP_H
+
+
+#include "uld.h"
+#include "uld_dyn.h"
+
+
+// Post-initialization snapshot of the loaded module set kept in the
+// ULD_SNAPSHOT flash area (see linker script).  Enabled with ULD_SNAPSHOT.
+#define ULD_SNAP_MAGIC                              0x50414e53
+
+// Linker defined symbols.
+extern uint8_t _s_uld_snapshot;
+extern uint8_t _uld_snapshot_size;
+#define ULD_SNAP_BASE                               (&_s_uld_snapshot)
+#define ULD_SNAP_SIZE                               \
+        ((size_t)&_uld_snapshot_size)
+
+
+struct uld_snap_file {
+    const struct uld_fs_entry *fse;
+    uint32_t crc;
+};
+
+// Followed by a copy of uld_dyn_state and the module memory span (all
+// membase and dl_alloc ranges).  crc covers everything after itself.
+struct uld_snap_hdr {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t boot_action;
+    uint32_t pstore_crc;
+    const void *state;
+    size_t state_size;
+    uint8_t *mem_base;
+    size_t mem_size;
+    int file_count;
+    struct uld_snap_file file[ULD_DYN_FILE_MAX];
+};
+
+
+// Save uld_dyn_state and module memory after constructors have run.
+int uld_snap_save(void);
+
+// Restore a snapshot taken with the same boot_action, pstore settings (see
+// uld_crc_calc_pstore) and module set (fs entry and crc) with exec_fse as
+// the executable.  Returns 0 if restored, uld_dyn_state.exec_idx is the
+// executable to start.  Must be called before any module memory is
+// allocated.
+int uld_snap_restore(const struct uld_fs_entry *exec_fse);
+
+
+#endif  // _ULD_SNAP_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_SVC_H
+#define _ULD_SVC_H
+
+
+#include "uld.h"
+
+
+// Loader service numbers, passed as the svc instruction immediate.
+// Arguments and return value use r0-r3/r0 per AAPCS.
+#define ULD_SVC_DLOPEN                              0x01
+#define ULD_SVC_DLSYM                               0x02
+#define ULD_SVC_DLCLOSE                             0x03
+#define ULD_SVC_MODULE_INIT                         0x04
+#define ULD_SVC_SWAP                                0x05
+#define ULD_SVC_PATCH                               0x06
+#define ULD_SVC_OVERLAY                             0x07
+#define ULD_SVC_IRQ                                 0x08
+
+// Passed to uld_swap_migrate if the new version of a swapped library
+// defines it.  Called after the new version's constructors with its own
+// r9, old_membase is the previous version's .got/.data/.bss which is freed
+// on return.
+#define ULD_SWAP_MIGRATE_SYM                        "uld_swap_migrate"
+struct uld_swap_info {
+    const void *old_membase;
+    size_t old_memsz;
+    const char *old_name;
+};
+
+#ifdef __ULD__
+// Exception stack frame pushed by hardware.  See ARM DDI0403E B1.5.6.
+struct uld_svc_frame {
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t xpsr;
+};
+
+void uld_svc_init(void);
+
+// Called from vector_svc (uld_svc_asm.S), return value is written to the
+// caller's r0.
+uint32_t uld_svc_dispatch(unsigned int num, struct uld_svc_frame *frame);
+
+// Function in uld_svc_asm.S
+void vector_svc(void);
+#else  // __ULD__
+// Services are handled in exception context by uld.  They can not be called
+// from another exception handler including a constructor run by a service
+// (uld_dlopen).  Registers other than r0 are restored from the exception
+// frame on return.
+#define ULD_SVC_CALL(num, a0, a1) \
+    ({ \
+        register uint32_t _r0 asm("r0") = (uint32_t)(a0); \
+        register uint32_t _r1 asm("r1") = (uint32_t)(a1); \
+        asm volatile ("svc %[svc_num]" \
+                : "+r" (_r0) \
+                : [svc_num] "I" (num), "r" (_r1) \
+                : "memory"); \
+        _r0; \
+    })
+
+// Load name and any dependencies not already loaded.  Returns a handle or
+// NULL on error.
+static __inline __always_inline __notrace void *uld_dlopen(const char *name)
+{
+    return (void *)ULD_SVC_CALL(ULD_SVC_DLOPEN, name, 0);
+}
+
+// Returns a function pointer (descriptor) for functions or a pointer for
+// objects, NULL if not found.  A NULL handle searches all loaded modules.
+static __inline __always_inline __notrace void *uld_dlsym(void *handle,
+        const char *name)
+{
+    return (void *)ULD_SVC_CALL(ULD_SVC_DLSYM, handle, name);
+}
+
+// Returns 0 on success or -1 on error.
+static __inline __always_inline __notrace int uld_dlclose(void *handle)
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_DLCLOSE, handle, 0);
+}
+
+// Run constructors deferred until first use for a loaded module and its
+// dependencies.  Returns 0 on success or -1 if name is not loaded.
+static __inline __always_inline __notrace int uld_module_init(
+        const char *name)
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_MODULE_INIT, name, 0);
+}
+
+// Replace loaded library old_name with new_name, a newly installed version.
+// Call at a point where no code from old_name is running.  Returns 0 on
+// success or -1 if nothing was changed.
+static __inline __always_inline __notrace int uld_swap(const char *old_name,
+        const char *new_name)
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_SWAP, old_name, new_name);
+}
+
+// Apply patch module patch_name to loaded library target_name (see
+// uld_dyn_patch).  Returns 0 on success or -1 on error.
+static __inline __always_inline __notrace int uld_patch(
+        const char *patch_name, const char *target_name)
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_PATCH, patch_name, target_name);
+}
+
+// Load overlay member name into its group's window, evicting the active
+// member (see uld_dyn_overlay).  Calls through imports of an inactive member
+// do this on demand.  Returns 0 on success or -1 on error.
+static __inline __always_inline __notrace int uld_overlay(const char *name)
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_OVERLAY, name, 0);
+}
+
+// Route irq (0 based IRQ number) to handler, which runs in handler mode
+// with its module's r9, and enable it.  NULL handler disables irq.  IRQs are
+// released when the handler's module is unloaded.  Returns 0 on success or
+// -1 on error.
+static __inline __always_inline __notrace int uld_irq(int irq,
+        void (*handler)(void))
+{
+    return (int)ULD_SVC_CALL(ULD_SVC_IRQ, irq, handler);
+}
+#endif  // __ULD__
+
+
+#endif  // _ULD_SVC_H
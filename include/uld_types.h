@@ -41,6 +41,24 @@ struct uld_fs_entry {
     char name[];
 };
 
+// NOTE: If changing these flags update gen-uld-files.py.
+#define ULD_FS_ENTRY_FLAG_NONE                      0x00000000
+#define ULD_FS_ENTRY_FLAG_LAZY                      0x00000001
+#define ULD_FS_ENTRY_FLAG_DEFER_INIT                0x00000002
+// Overlay group 1-7, 0 if not an overlay member (see uld_dyn_overlay).
+#define ULD_FS_ENTRY_FLAG_OVERLAY_MASK              0x00000070
+#define ULD_FS_ENTRY_FLAG_OVERLAY_SHIFT             4
+// Copy the executable flash sections to RAM at load (see uld_load_file_at).
+#define ULD_FS_ENTRY_FLAG_RAM                       0x00000080
+// Keep function descriptors in a flash table (see uld_reloc_update_fdtab).
+#define ULD_FS_ENTRY_FLAG_FDTAB                     0x00000100
+// Boot the executable from a prelinked image (see uld_flat.h).
+#define ULD_FS_ENTRY_FLAG_FLAT                      0x00000200
+// Stack size the executable declares in 8 byte units, 0 if it does not
+// declare one (see ULD_STACK_SIZE).
+#define ULD_FS_ENTRY_FLAG_STACK_MASK                0xffff0000
+#define ULD_FS_ENTRY_FLAG_STACK_SHIFT               16
+
 // NOTE: If changing this structure update patch-uld-elf.py and uld_data.S.
 struct uld_fs_table {
     struct uld_fs_entry *head;
@@ -49,12 +67,27 @@ struct uld_fs_table {
     uint32_t crc;
 };
 
+#define ULD_PSTORE_CHAIN_NONE                       0xffffffff
+#define ULD_PSTORE_PRELOAD_SIZE                     64
+#define ULD_PSTORE_MEM_PLACE_SIZE                   64
+
 // NOTE: If changing this structure update patch-uld-elf.py and uld_data.S.
 struct uld_pstore {
     uint32_t boot_action;
     const void *files_base;
     uint32_t files_size;
     struct uld_fs_table fs_table_pri;
+    // boot_action of the executable to run when the boot executable returns
+    // (see uld_main).
+    uint32_t chain_action;
+    // Space or comma separated module names loaded before the executable
+    // and searched first when resolving symbols (see uld_dyn_resolve_rel).
+    char preload[ULD_PSTORE_PRELOAD_SIZE];
+    // Default module memory policy (ULD_MEM_POLICY_*, see uld_mem.h).
+    uint32_t mem_policy;
+    // Space or comma separated name:bank pairs pinning a module's memory
+    // (or the dl_alloc pool with name dl_alloc) to a RAM bank.
+    char mem_place[ULD_PSTORE_MEM_PLACE_SIZE];
 };
 
 
@@ -125,7 +158,26 @@ struct uld_file {
     const void *adjusted_entry;
     uint8_t *membase;
     size_t memsz;
+    uint8_t *dl_alloc_base;
+    size_t dl_alloc_size;
+    // Linked copy of .data for warm reset (see uld_warm.h).
+    uint8_t *data_image;
+    // RAM copy of the executable flash sections (ULD_FS_ENTRY_FLAG_RAM).
+    uint8_t *text_image;
+    size_t text_size;
+    // Arena seeded into the file's heap_default export (see heap.h).
+    uint8_t *heap_base;
+    size_t heap_size;
     uint32_t flags;
+    int refcount;
+    // Handles to this file returned by uld_dyn_dlopen and not yet closed.
+    int dlopen_count;
+    // Resolution records: bit n is set if a relocation in this file was
+    // resolved by file n in the loaded file list.
+    uint32_t res_mask;
+    // Program instance.  Files only resolve against files of the same
+    // instance (see uld_dyn_exec_fse_list).
+    int instance;
     union uld_file_section_num num;
 };
 
@@ -133,6 +185,12 @@ struct uld_file {
 
 #define ULD_FILE_FLAG_NONE                          0x00000000
 #define ULD_FILE_FLAG_EXEC                          0x00000001
+#define ULD_FILE_FLAG_DLOPEN                        0x00000002
+#define ULD_FILE_FLAG_INIT_DONE                     0x00000004
+#define ULD_FILE_FLAG_PRELOAD                       0x00000008
+#define ULD_FILE_FLAG_OVERLAY                       0x00000010
+// Loaded for a running executable, never released by uld_dyn_dlclose.
+#define ULD_FILE_FLAG_BOOT                          0x00000020
 
 
 #endif  // _ULD_TYPES_H
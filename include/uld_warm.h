@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ULD_WARM_H
+#define _ULD_WARM_H
+
+
+#include "uld.h"
+#include "uld_dyn.h"
+
+
+// Warm reset support (ULD_WARM_RESET).  uld_dyn_state and a descriptor of
+// the loaded module set are kept in .noinit RAM.  On reset, if the module
+// set, loader state and GOTs still match the descriptor checksums, module
+// .data is restored from a copy taken after linking, .bss and objects
+// allocated in the dl_alloc pool are zeroed instead of loading and linking
+// again.
+#define ULD_WARM_MAGIC                              0x4d524157
+
+
+struct uld_warm_file {
+    const struct uld_fs_entry *fse;
+    uint32_t crc;
+};
+
+// state_crc covers the descriptor after itself and uld_dyn_state, it is
+// checked first so a corrupt state is never walked.  mem_crc covers each
+// file's .got/.got.plt and .data image.
+struct uld_warm_desc {
+    uint32_t magic;
+    uint32_t state_crc;
+    uint32_t mem_crc;
+    uint32_t boot_action;
+    uint32_t pstore_crc;
+    int file_count;
+    struct uld_warm_file file[ULD_DYN_FILE_MAX];
+};
+
+
+#ifdef ULD_WARM_RESET
+// Copy linked .data to ufile->data_image, call after linking and before
+// constructors.
+void uld_warm_save_data(struct uld_file *ufile);
+void uld_warm_free_data(struct uld_file *ufile);
+
+// Update the descriptor after the loaded set or its GOTs change.
+void uld_warm_update(void);
+
+// Returns 0 if the module set for exec_fse was recovered.  Constructors
+// have to be run again.  Must be called before any module memory is
+// allocated.
+int uld_warm_restore(const struct uld_fs_entry *exec_fse);
+#else  // ULD_WARM_RESET
+#define uld_warm_save_data(ufile)
+#define uld_warm_free_data(ufile)
+#define uld_warm_update()
+#define uld_warm_restore(exec_fse)                  -1
+#endif  // ULD_WARM_RESET
+
+
+#endif  // _ULD_WARM_H
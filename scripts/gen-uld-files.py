@@ -23,6 +23,7 @@
 import argparse
 import commands
 import os
+import struct
 import sys
 import tempfile
 import zlib
@@ -38,6 +39,21 @@ DEFAULT_FS_TBL_SYM_DEF = '_ULD_FS_TABLE'
 
 DEFAULT_SEC_FLAGS = 'alloc,contents,load,readonly,code'
 
+# NOTE: Keep in sync with ULD_FS_ENTRY_FLAG_* in uld_types.h.
+FS_ENTRY_FLAG_LAZY = 0x00000001
+FS_ENTRY_FLAG_DEFER_INIT = 0x00000002
+FS_ENTRY_FLAG_OVERLAY_SHIFT = 4
+FS_ENTRY_OVERLAY_MAX = 7
+FS_ENTRY_FLAG_RAM = 0x00000080
+FS_ENTRY_FLAG_FDTAB = 0x00000100
+FS_ENTRY_FLAG_FLAT = 0x00000200
+FS_ENTRY_FLAG_STACK_SHIFT = 16
+FS_ENTRY_STACK_UNIT = 8
+FS_ENTRY_STACK_MAX = 0xffff * FS_ENTRY_STACK_UNIT
+
+# NOTE: Keep in sync with ULD_STACK_SIZE in uld.h.
+STACK_SEC_NAME = '.uld_stack'
+
 _debug = 0
 
 
@@ -149,16 +165,88 @@ def o_add_file(secname, inpath, objpath, newpath=None):
     qc(cmd)
 
 
+# Stack size an executable declares in its .uld_stack section (see
+# ULD_STACK_SIZE in uld.h) rounded up to FS_ENTRY_STACK_UNIT, 0 if it does
+# not declare one.
+def get_stack_size(path, tmpfiles):
+    objcopy = os.environ.get('OBJCOPY', 'objcopy')
+    tfd, tpath = new_tmp(tmpfiles)
+    os.close(tfd)
+    qc('{} -O binary -j {} {} {}'.format(objcopy, STACK_SEC_NAME, path,
+            tpath))
+
+    fd = os.open(tpath, os.O_RDONLY)
+    data = os.read(fd, 4)
+    os.close(fd)
+    if len(data) < 4:
+        return 0
+
+    size = struct.unpack('<I', data)[0]
+    size += pad_len(size, 3)
+    if size > FS_ENTRY_STACK_MAX:
+        raise GenError('{} stack size {} greater than {}'.format(path, size,
+                FS_ENTRY_STACK_MAX))
+    return size
+
+
 def gen_hdr(args, hdr_info):
     ret = []
 
     base = 0
     next_e = 0
-    flags = 0
     last = len(hdr_info) - 1
 
+    lazy = []
+    if args.lazy is not None:
+        lazy = args.lazy.split(',')
+
+    defer_init = []
+    if args.defer_init is not None:
+        defer_init = args.defer_init.split(',')
+
+    ram = []
+    if args.ram is not None:
+        ram = args.ram.split(',')
+
+    fdtab = []
+    if args.fdtab is not None:
+        fdtab = args.fdtab.split(',')
+
+    flat = []
+    if args.flat is not None:
+        flat = args.flat.split(',')
+
+    overlay = {}
+    if args.overlay is not None:
+        for entry in args.overlay.split(','):
+            name, _, group = entry.partition(':')
+            try:
+                group = int(group)
+            except ValueError:
+                group = 0
+            if group < 1 or group > FS_ENTRY_OVERLAY_MAX:
+                raise GenError('Overlay {} group must be 1-{}'.format(
+                        entry, FS_ENTRY_OVERLAY_MAX))
+            overlay[name] = group
+
     for index, info in enumerate(hdr_info):
-        name, size, crc = info
+        name, size, crc, stack_size = info
+
+        flags = 0
+        if name in lazy:
+            flags |= FS_ENTRY_FLAG_LAZY
+        if name in defer_init:
+            flags |= FS_ENTRY_FLAG_DEFER_INIT
+        if name in overlay:
+            flags |= overlay[name] << FS_ENTRY_FLAG_OVERLAY_SHIFT
+        if name in ram:
+            flags |= FS_ENTRY_FLAG_RAM
+        if name in fdtab:
+            flags |= FS_ENTRY_FLAG_FDTAB
+        if name in flat:
+            flags |= FS_ENTRY_FLAG_FLAT
+        flags |= (stack_size // FS_ENTRY_STACK_UNIT) << \
+                FS_ENTRY_FLAG_STACK_SHIFT
 
         # Before Python 3.0 zlib.crc32 may return a negative value, this
         # will prevent format from prepending a negative sign without changing
@@ -284,6 +372,7 @@ def gen_uld_files(args, tmpfiles):
                     break
 
         size = os.fstat(fd).st_size
+        stack_size = get_stack_size(path, tmpfiles)
 
         # objcopy does not support changing alignment on ELF sections.  Pad
         # the input files here and they will be aligned together on final
@@ -300,7 +389,7 @@ def gen_uld_files(args, tmpfiles):
             crc32 = crcfd(fd)
             opath = path
 
-        hdr_info.append((secname, size + pad, crc32))
+        hdr_info.append((secname, size + pad, crc32, stack_size))
         os.close(fd)
 
         secname = '{}.{}'.format(args.file_section, secname)
@@ -366,6 +455,28 @@ def main(argv=None):
             help='fs table size define name (default: {})'.format(
             DEFAULT_FS_TABLE_SIZE_DEF))
 
+    parser.add_argument('--lazy', type=str,
+            help='Comma separated file name(s) to mark for lazy loading')
+
+    parser.add_argument('--defer-init', type=str,
+            help='Comma separated file name(s) to defer constructors until '
+            'first use')
+
+    parser.add_argument('--overlay', type=str,
+            help='Comma separated name:group pair(s) of overlay members '
+            '(group 1-{})'.format(FS_ENTRY_OVERLAY_MAX))
+
+    parser.add_argument('--ram', type=str,
+            help='Comma separated file name(s) to execute from RAM')
+
+    parser.add_argument('--fdtab', type=str,
+            help='Comma separated file name(s) to build flash function '
+            'descriptor tables for')
+
+    parser.add_argument('--flat', type=str,
+            help='Comma separated executable name(s) to keep a prelinked '
+            'image of')
+
     parser.add_argument('--verbose', action='store_true')
 
     parser.add_argument('hdr', type=str,
@@ -45,6 +45,7 @@ ROFIXUP_MEM_SEC_LIST = [
     '.got',
     '.got.plt',
     '.data',
+    '.ramfunc',
     '.bss'
 ]
 
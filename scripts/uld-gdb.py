@@ -177,7 +177,7 @@ class CmdUldExample(gdb.Command):
 
 class CmdUldExampleSet(gdb.Command):
     """set uld example (int)"""
-    MAX_EXAMPLE_INDEX = 6
+    MAX_EXAMPLE_INDEX = 8
 
     def __init__(self):
         super(CmdUldExampleSet, self).__init__('uld example set',
@@ -200,6 +200,168 @@ class CmdUldExampleSet(gdb.Command):
         print('uld example set to \'{}\''.format(val))
 
 
+class CmdUldExampleChain(gdb.Command):
+    """set uld example to chain to when the example returns (int, -1 for
+    none)"""
+
+    def __init__(self):
+        super(CmdUldExampleChain, self).__init__('uld example chain',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE, True)
+
+    def invoke(self, argument, from_tty):
+        try:
+            val = int(argument)
+        except ValueError:
+            print('argument must be int')
+            return
+        if val < -1 or val > CmdUldExampleSet.MAX_EXAMPLE_INDEX:
+            print('argument must be between -1 and {}'.format(
+                    CmdUldExampleSet.MAX_EXAMPLE_INDEX))
+            return
+        cmd = 'p ((struct uld_pstore *)&_uld_pstore)->chain_action = {}'
+        gdb.execute(cmd.format(val & 0xffffffff),
+                to_string=True)
+        print('uld example chain set to \'{}\''.format(val))
+
+
+class CmdUldPreload(gdb.Command):
+    """set modules loaded before the executable and searched first for
+    symbols (space or comma separated names, no argument to clear)"""
+
+    PRELOAD_SIZE = 64
+
+    def __init__(self):
+        super(CmdUldPreload, self).__init__('uld preload',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE)
+
+    def invoke(self, argument, from_tty):
+        val = argument.strip().encode('ascii')
+        if len(val) >= self.PRELOAD_SIZE:
+            print('argument must be less than {} chars'.format(
+                    self.PRELOAD_SIZE))
+            return
+        val = val.ljust(self.PRELOAD_SIZE, b'\0')
+        cmd = 'p ((struct uld_pstore *)&_uld_pstore)->preload[{}] = {}'
+        for i, c in enumerate(bytearray(val)):
+            gdb.execute(cmd.format(i, c), to_string=True)
+        print('uld preload set to \'{}\''.format(argument.strip()))
+
+
+class CmdUldMem(gdb.Command):
+    def __init__(self):
+        super(CmdUldMem, self).__init__('uld mem',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE, True)
+
+    def invoke(self, argument, from_tty):
+        gdb.execute('help uld mem')
+
+
+class CmdUldMemPolicy(gdb.Command):
+    """set the module memory placement policy (first or best fit)"""
+
+    POLICIES = ('first', 'best')
+
+    def __init__(self):
+        super(CmdUldMemPolicy, self).__init__('uld mem policy',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE)
+
+    def invoke(self, argument, from_tty):
+        val = argument.strip()
+        if val not in self.POLICIES:
+            print('argument must be one of: {}'.format(
+                    ', '.join(self.POLICIES)))
+            return
+        cmd = 'p ((struct uld_pstore *)&_uld_pstore)->mem_policy = {}'
+        gdb.execute(cmd.format(self.POLICIES.index(val)), to_string=True)
+        print('uld mem policy set to \'{} fit\''.format(val))
+
+
+class CmdUldMemPlace(gdb.Command):
+    """pin module memory to RAM banks (space or comma separated name:bank
+    pairs, dl_alloc for the dl_alloc pool, no argument to clear)"""
+
+    MEM_PLACE_SIZE = 64
+
+    def __init__(self):
+        super(CmdUldMemPlace, self).__init__('uld mem place',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE)
+
+    def invoke(self, argument, from_tty):
+        val = argument.strip().encode('ascii')
+        if len(val) >= self.MEM_PLACE_SIZE:
+            print('argument must be less than {} chars'.format(
+                    self.MEM_PLACE_SIZE))
+            return
+        val = val.ljust(self.MEM_PLACE_SIZE, b'\0')
+        cmd = 'p ((struct uld_pstore *)&_uld_pstore)->mem_place[{}] = {}'
+        for i, c in enumerate(bytearray(val)):
+            gdb.execute(cmd.format(i, c), to_string=True)
+        print('uld mem place set to \'{}\''.format(argument.strip()))
+
+
+class CmdUldAudit(gdb.Command):
+    """print binding statistics collected in uld_audit_stats (ULD_AUDIT=1)
+    sorted by lookups"""
+
+    REL_TYPES = ('ABS32', 'GLOB_DAT', 'FUNCDESC', 'FUNCDESC_VALUE')
+
+    def __init__(self):
+        super(CmdUldAudit, self).__init__('uld audit',
+                gdb.COMMAND_NONE, gdb.COMPLETE_NONE)
+
+    @staticmethod
+    def file_name(f):
+        return f['fse']['name'].string()
+
+    def invoke(self, argument, from_tty):
+        try:
+            st = gdb.parse_and_eval('uld_audit_stats')
+        except gdb.error:
+            print('uld_audit_stats not found, build with ULD_AUDIT=1')
+            return
+
+        files = []
+        count = st['file'].type.range()[1] + 1
+        for i in range(count):
+            f = st['file'][i]
+            if int(f['fse']) == 0:
+                break
+            files.append(f)
+
+        print('{:<16} {:>5} {:>8} {:>12}'.format('file', 'loads',
+                'funcdesc', 'init cycles'))
+        for f in files:
+            print('{:<16} {:>5} {:>8} {:>12}'.format(self.file_name(f),
+                    int(f['load_count']), int(f['funcdesc_count']),
+                    int(f['init_cycles'])))
+
+        binds = []
+        for r in range(len(files)):
+            for p in range(len(files)):
+                b = st['bind'][r][p]
+                if int(b['count']):
+                    binds.append((int(b['lookups']), int(b['count']), r, p))
+        binds.sort(reverse=True)
+
+        print('\n{:<16} {:<16} {:>5} {:>7}'.format('requester', 'provider',
+                'binds', 'lookups'))
+        for lookups, bcount, r, p in binds:
+            print('{:<16} {:<16} {:>5} {:>7}'.format(
+                    self.file_name(files[r]), self.file_name(files[p]),
+                    bcount, lookups))
+
+        print('')
+        for i, name in enumerate(self.REL_TYPES):
+            print('{:<16} {}'.format(name, int(st['rel_count'][i])))
+        print('{:<16} {}'.format('lookups', int(st['lookups'])))
+        if int(st['max_lookups_name']):
+            print('{:<16} {} ({})'.format('max lookups',
+                    int(st['max_lookups']),
+                    st['max_lookups_name'].string()))
+        if int(st['dropped']):
+            print('{:<16} {}'.format('dropped', int(st['dropped'])))
+
+
 def uld_load():
     print('loading {}'.format(sys.version))
     CmdUld()
@@ -220,6 +382,12 @@ def uld_load():
     CmdUldQEMUStepi('usi')
     CmdUldExample()
     CmdUldExampleSet()
+    CmdUldExampleChain()
+    CmdUldPreload()
+    CmdUldMem()
+    CmdUldMemPolicy()
+    CmdUldMemPlace()
+    CmdUldAudit()
 
 
 if __name__ == '__main__':
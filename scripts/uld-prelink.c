@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+// Host prelinker.  The loader's linking code is built for the host with
+// ULD_HOST and run against a flash image of uld.bin mapped at its target
+// address.  uld_dyn_exec_fse runs for each executable given up to the
+// point it would jump to the entry point, with uld_dyn_state placed at its
+// uld.elf address (see the prelink target in the Makefile).  Executables
+// marked ULD_FS_ENTRY_FLAG_FLAT save their flat image to ULD_FLAT while
+// linking and the resulting flash image is written out.
+//
+// There is one ULD_FLAT area, the image of the last executable given is
+// kept and the others are only checked to link.
+//
+// Usage: uld-prelink [--verbose] in.bin out.bin exec...
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_dyn.h"
+#include "uld_exec.h"
+#include "uld_flat.h"
+#include "uld_fs.h"
+#include "uld_irq.h"
+#include "uld_mem.h"
+#include "uld_sched.h"
+
+
+#define PRELINK_FLASH_BASE \
+    ((uint8_t *)CONFIG_FLASH_BASE_ADDR)
+#define PRELINK_FLASH_SIZE                          (CONFIG_FLASH_SIZE * 1024)
+#define PRELINK_SRAM_BASE \
+    ((uint8_t *)CONFIG_SRAM_BASE_ADDR)
+#define PRELINK_SRAM_SIZE                           (CONFIG_SRAM_SIZE * 1024)
+// Stack pointer seen by the loader, uld_dyn_get_stack_top only uses it
+// when the executable does not declare a stack size.
+#define PRELINK_SP                                  ((uint32_t)ESTACK - 0x100)
+
+#define PRELINK_EXIT_EXEC                           1
+#define PRELINK_EXIT_BREAK                          2
+
+
+FILE _SWI_STDOUT;
+int uld_verbose;
+struct uld_irq_entry uld_irq_table[CONFIG_CPU_IRQ_NUM];
+
+static jmp_buf prelink_jmp;
+static int prelink_flash_lock_state = 1;
+
+
+// Output of the loader goes to the host stdout.
+int fprintf(FILE *stream, const char *format, ...)
+{
+    va_list ap;
+    int ret;
+
+    va_start(ap, format);
+    ret = vprintf(format, ap);
+    va_end(ap);
+    return ret;
+}
+
+int fputs(const char *s, FILE *stream)
+{
+    return printf("%s", s);
+}
+
+int putc(int c, FILE *stream)
+{
+    return putchar(c);
+}
+
+uint32_t cpu_get_fb(void)
+{
+    return 0;
+}
+
+uint32_t cpu_get_sp(void)
+{
+    return PRELINK_SP;
+}
+
+uint32_t cpu_get_pc(void)
+{
+    return 0;
+}
+
+uint32_t cpu_get_cycles(void)
+{
+    return 0;
+}
+
+// Same as the QEMU flash in cpu.c, erased flash reads as 0.
+int cpu_flash_is_locked(void)
+{
+    return prelink_flash_lock_state;
+}
+
+int cpu_flash_unlock(void)
+{
+    prelink_flash_lock_state = 0;
+    return 0;
+}
+
+int cpu_flash_lock(void)
+{
+    prelink_flash_lock_state = 1;
+    return 0;
+}
+
+int cpu_flash_erase(void *s, size_t n)
+{
+    if (prelink_flash_lock_state) {
+        return -1;
+    }
+    memset(s, 0, n);
+    return 0;
+}
+
+int cpu_flash_write(void *dest, const void *src, size_t n)
+{
+    if (prelink_flash_lock_state) {
+        return -1;
+    }
+    memmove(dest, src, n);
+    return 0;
+}
+
+void uld_host_break(const char *file, int line)
+{
+    printf("break at %s:%d\n", file, line);
+    longjmp(prelink_jmp, PRELINK_EXIT_BREAK);
+}
+
+// Module code is not run, constructors are run by the target after the
+// flat image is restored.
+int uld_exec_elf_call_init_funcs(struct uld_file *ufile)
+{
+    return 0;
+}
+
+int uld_exec_elf_call_fini_funcs(struct uld_file *ufile)
+{
+    return 0;
+}
+
+int uld_exec_file(const struct uld_file *ufile, void *sp_base, int argc,
+        const char **argv)
+{
+    longjmp(prelink_jmp, PRELINK_EXIT_EXEC);
+}
+
+void uld_exec_call_vp_fp_fdpic_base(void (*fp)(void *), void *arg,
+        uint32_t fdpic_base)
+{
+    swbkpt();
+}
+
+int uld_irq_register(int irq, const void *funcdesc)
+{
+    return -1;
+}
+
+void uld_irq_release(const struct uld_file *ufile)
+{
+}
+
+int uld_sched_add_task(const void *entry, uint32_t fdpic_base, int instance,
+        uint8_t *stack_base, size_t stack_size, int argc, const char **argv)
+{
+    return -1;
+}
+
+void uld_sched_run(void)
+{
+}
+
+void uld_sched_lock(void)
+{
+}
+
+void uld_sched_unlock(void)
+{
+}
+
+
+static int prelink_rw(int fd, uint8_t *buf, size_t size, int do_write)
+{
+    ssize_t ret;
+    size_t done = 0;
+
+    while (done < size) {
+        if (do_write) {
+            ret = write(fd, buf + done, size - done);
+        } else {
+            ret = read(fd, buf + done, size - done);
+        }
+        if (ret < 0) {
+            return -1;
+        }
+        if (!ret) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+// Run in a child so each executable starts from fresh loader statics and
+// RAM while flash writes are shared through the MAP_SHARED mapping.
+static int prelink_exec(const char *name)
+{
+    const struct uld_fs_entry *fse;
+    const struct uld_flat_hdr *hdr = (const void *)ULD_FLAT_BASE;
+    int ret;
+
+    if (mmap(PRELINK_SRAM_BASE, PRELINK_SRAM_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) ==
+            MAP_FAILED) {
+        printf("can not map RAM\n");
+        return -1;
+    }
+
+    uld_mem_init();
+
+    fse = uld_fs_get_file_by_name(ULD_PSTORE->fs_table_pri.head, name);
+    if (!fse) {
+        printf("%s: not found\n", name);
+        return -1;
+    }
+    if (!(fse->flags & ULD_FS_ENTRY_FLAG_FLAT)) {
+        printf("%s: not marked flat\n", name);
+        return -1;
+    }
+
+    ret = setjmp(prelink_jmp);
+    if (!ret) {
+        uld_dyn_exec_fse(fse, NULL, 0, NULL);
+        printf("%s: returned without exec\n", name);
+        return -1;
+    }
+    if (ret != PRELINK_EXIT_EXEC) {
+        return -1;
+    }
+
+    if (hdr->magic != ULD_FLAT_MAGIC || hdr->exec_fse != fse) {
+        printf("%s: no flat image saved\n", name);
+        return -1;
+    }
+    printf("%s: prelinked %d files\n", name, hdr->file_count);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t size;
+    pid_t pid;
+    int status;
+    int fd;
+    int i = 1;
+
+    if (argc > i && !strcmp(argv[i], "--verbose")) {
+        uld_verbose = 1;
+        i++;
+    }
+    if (argc - i < 3) {
+        printf("usage: uld-prelink [--verbose] in.bin out.bin exec...\n");
+        return 1;
+    }
+
+    if (mmap(PRELINK_FLASH_BASE, PRELINK_FLASH_SIZE, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED, -1, 0) ==
+            MAP_FAILED) {
+        printf("can not map flash\n");
+        return 1;
+    }
+
+    fd = open(argv[i], O_RDONLY);
+    if (fd < 0) {
+        printf("can not open %s\n", argv[i]);
+        return 1;
+    }
+    size = prelink_rw(fd, PRELINK_FLASH_BASE, PRELINK_FLASH_SIZE, 0);
+    close(fd);
+    if ((ssize_t)size <= 0) {
+        printf("can not read %s\n", argv[i]);
+        return 1;
+    }
+
+    for (int j = i + 2; j < argc; j++) {
+        pid = fork();
+        if (pid < 0) {
+            return 1;
+        }
+        if (!pid) {
+            exit(prelink_exec(argv[j]) ? 1 : 0);
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+                WEXITSTATUS(status)) {
+            printf("%s: prelink failed\n", argv[j]);
+            return 1;
+        }
+    }
+
+    // The flat area follows the flash image objcopy wrote.
+    if (size < (size_t)(ULD_FLAT_BASE + ULD_FLAT_SIZE - PRELINK_FLASH_BASE)) {
+        size = ULD_FLAT_BASE + ULD_FLAT_SIZE - PRELINK_FLASH_BASE;
+    }
+
+    fd = open(argv[i + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("can not open %s\n", argv[i + 1]);
+        return 1;
+    }
+    if (prelink_rw(fd, PRELINK_FLASH_BASE, size, 1) != (int)size) {
+        printf("can not write %s\n", argv[i + 1]);
+        close(fd);
+        return 1;
+    }
+    close(fd);
+
+    return 0;
+}
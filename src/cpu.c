@@ -24,6 +24,10 @@
 #include "cpu.h"
 
 
+#ifdef CONFIG_CPU_VEC_IN_MEM
+extern uint32_t mem_vector_table[];
+#endif
+
 static uint8_t cpu_flash_lock_state = 1;
 
 void cpu_reset_clks(void)
@@ -34,6 +38,15 @@ void cpu_init_clks(void)
 {
 }
 
+void cpu_init_cycle_counter(void)
+{
+    *(volatile uint32_t *)ARM_CORTEX_M_DEMCR_ADDR |=
+            ARM_CORTEX_M_DEMCR_TRCENA;
+    *(volatile uint32_t *)ARM_CORTEX_M_DWT_CYCCNT_ADDR = 0;
+    *(volatile uint32_t *)ARM_CORTEX_M_DWT_CTRL_ADDR |=
+            ARM_CORTEX_M_DWT_CTRL_CYCCNTENA;
+}
+
 int cpu_flash_is_locked(void)
 {
     return cpu_flash_lock_state;
@@ -76,3 +89,20 @@ int cpu_flash_write(void *dest, const void *src, size_t n)
     memmove(dest, src, n);
     return 0;
 }
+
+int cpu_memvec_set(int exc_num, void (*handler)(void))
+{
+#ifdef CONFIG_CPU_VEC_IN_MEM
+    if (exc_num < CPU_MEMVEC_EXC_FIRST ||
+            exc_num >= CPU_MEMVEC_EXC_FIRST + CPU_MEMVEC_NUM) {
+        return -1;
+    }
+
+    // Each entry is the jump insn followed by the handler address.
+    mem_vector_table[((exc_num - CPU_MEMVEC_EXC_FIRST) * 2) + 1] =
+            ARM_THUMB_BRANCH_ADDR((uint32_t)handler);
+    return 0;
+#else
+    return -1;
+#endif
+}
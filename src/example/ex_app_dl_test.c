@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_svc.h"
+
+
+static void *ex_dl_test_sym(void *handle, const char *name)
+{
+    void *ptr;
+
+    ptr = uld_dlsym(handle, name);
+    printf("dlsym %s: %p\n", name, ptr);
+    if (!ptr) {
+        swbkpt();
+    }
+
+    return ptr;
+}
+
+static void ex_dl_test_libgarage(void)
+{
+    void *handle;
+    void (*print_banner)(void);
+    void (*inc_car)(void);
+    void (*print_car_count)(void);
+    int *car_count;
+
+    handle = uld_dlopen("libgarage.so");
+    printf("dlopen libgarage.so: %p\n", handle);
+    if (!handle) {
+        swbkpt();
+        return;
+    }
+
+    print_banner = ex_dl_test_sym(handle, "ex_garage_print_banner");
+    inc_car = ex_dl_test_sym(handle, "ex_garage_inc_car");
+    print_car_count = ex_dl_test_sym(handle, "ex_garage_print_car_count");
+    car_count = ex_dl_test_sym(handle, "ex_garage_car_count");
+
+    print_banner();
+    inc_car();
+    inc_car();
+    printf("expected car count: %d - ", *car_count);
+    print_car_count();
+
+    // libprint.so was loaded as a dependency of libgarage.so.
+    ex_dl_test_sym(NULL, "ex_print_cow");
+
+    printf("dlclose libgarage.so: %d\n\n", uld_dlclose(handle));
+}
+
+static void ex_dl_test_libftable(void)
+{
+    void *handle;
+    int (*func_c)(int);
+
+    handle = uld_dlopen("libftable.so");
+    printf("dlopen libftable.so: %p\n", handle);
+    if (!handle) {
+        swbkpt();
+        return;
+    }
+
+    func_c = ex_dl_test_sym(handle, "ex_ftable_func_c");
+    func_c(42);
+
+    printf("dlclose libftable.so: %d\n\n", uld_dlclose(handle));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t pc = cpu_get_pc();
+    uint32_t sp = cpu_get_sp();
+    uint32_t fb = cpu_get_fb();
+
+    printf("dl_test.elf\n");
+    printf("registers pc: 0x%08lx sp: 0x%08lx fb: 0x%08lx\n\n", pc, sp, fb);
+
+    ex_dl_test_libgarage();
+    ex_dl_test_libftable();
+
+    // Memory released by dlclose is reused.
+    ex_dl_test_libgarage();
+
+    if (uld_dlopen("does_not_exist.so")) {
+        swbkpt();
+    }
+
+    swbkpt();
+    while (1);
+}
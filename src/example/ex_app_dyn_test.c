@@ -22,10 +22,16 @@
 
 #include "uld.h"
 #include "cpu.h"
+#include "heap.h"
+#include "uld_svc.h"
 
 #include "ex_libs.h"
 
 
+ULD_STACK_SIZE(0x800);
+ULD_HEAP_SIZE(0x800);
+
+
 __ctor static void ex_dyn_test_ctor(void)
 {
     uint32_t pc = cpu_get_pc();
@@ -54,6 +60,200 @@ static void ex_dyn_test_print_ex_ftable_ptr(void)
         *(void **)ex_ftable_ptr->ptr_c);
 }
 
+// Same hot loop executed from flash and from the .ramfunc RAM copy.
+static uint32_t __attribute__((noinline)) ex_dyn_test_sum(const uint8_t *buf,
+        size_t len)
+{
+    uint32_t sum = 0;
+
+    while (len--) {
+        sum = (sum << 1 | sum >> 31) ^ *buf++;
+    }
+    return sum;
+}
+
+static uint32_t __ramfunc ex_dyn_test_sum_ram(const uint8_t *buf, size_t len)
+{
+    uint32_t sum = 0;
+
+    while (len--) {
+        sum = (sum << 1 | sum >> 31) ^ *buf++;
+    }
+    return sum;
+}
+
+void ex_dyn_test_ramfunc(void)
+{
+    uint8_t buf[256];
+    uint32_t flash_cycles;
+    uint32_t ram_cycles;
+    uint32_t flash_sum;
+    uint32_t ram_sum;
+    int i;
+
+    for (i = 0; i < (int)sizeof(buf); i++) {
+        buf[i] = i;
+    }
+
+    printf("\nflash sum at 0x%p ram sum at 0x%p\n",
+            *(void **)ex_dyn_test_sum, *(void **)ex_dyn_test_sum_ram);
+
+    flash_cycles = cpu_get_cycles();
+    flash_sum = ex_dyn_test_sum(buf, sizeof(buf));
+    flash_cycles = cpu_get_cycles() - flash_cycles;
+
+    ram_cycles = cpu_get_cycles();
+    ram_sum = ex_dyn_test_sum_ram(buf, sizeof(buf));
+    ram_cycles = cpu_get_cycles() - ram_cycles;
+
+    if (cpu_has_cycles()) {
+        printf("flash: 0x%08lx %lu cycles\n", flash_sum, flash_cycles);
+        printf("ram:   0x%08lx %lu cycles\n", ram_sum, ram_cycles);
+    } else {
+        printf("flash: 0x%08lx\n", flash_sum);
+        printf("ram:   0x%08lx\n", ram_sum);
+    }
+    if (flash_sum != ram_sum) {
+        printf("Error: flash and ram sum do not match\n");
+        swbkpt();
+    }
+}
+
+#define EX_DYN_TEST_CALL_COUNT                      100
+
+static int ex_dyn_test_local_cars;
+
+// Local counterpart of ex_garage_get_cars to compare a call through the PLT
+// (a direct veneer with ULD_PLT_VENEER) with a direct call.
+static int __attribute__((noinline)) ex_dyn_test_get_cars(void)
+{
+    return ex_dyn_test_local_cars;
+}
+
+#define EX_DYN_TEST_IRQ                             0
+
+static volatile int ex_dyn_test_irq_count;
+
+static void ex_dyn_test_irq_handler(void)
+{
+    ex_dyn_test_irq_count++;
+}
+
+// Route an unused IRQ (WWDG) to a handler in this module, pend it from
+// software and release it again.
+void ex_dyn_test_irq(void)
+{
+    int ret;
+
+    ret = uld_irq(EX_DYN_TEST_IRQ, ex_dyn_test_irq_handler);
+    printf("\nirq %d registered: %d\n", EX_DYN_TEST_IRQ, ret);
+    if (ret) {
+        swbkpt();
+        return;
+    }
+
+    *(volatile uint32_t *)ARM_CORTEX_M_NVIC_ISPR_ADDR =
+            1 << EX_DYN_TEST_IRQ;
+    __asm__ volatile ("dsb\n\tisb" ::: "memory");
+
+    printf("irq %d handled %d times\n", EX_DYN_TEST_IRQ,
+            ex_dyn_test_irq_count);
+    if (ex_dyn_test_irq_count != 1) {
+        printf("Error: irq handler did not run once\n");
+        swbkpt();
+    }
+
+    uld_irq(EX_DYN_TEST_IRQ, NULL);
+}
+
+void ex_dyn_test_plt(void)
+{
+    uint32_t plt_cycles;
+    uint32_t local_cycles;
+    int sum = 0;
+    int i;
+
+    ex_dyn_test_local_cars = ex_garage_get_cars();
+
+    plt_cycles = cpu_get_cycles();
+    for (i = 0; i < EX_DYN_TEST_CALL_COUNT; i++) {
+        sum += ex_garage_get_cars();
+    }
+    plt_cycles = cpu_get_cycles() - plt_cycles;
+
+    local_cycles = cpu_get_cycles();
+    for (i = 0; i < EX_DYN_TEST_CALL_COUNT; i++) {
+        sum -= ex_dyn_test_get_cars();
+    }
+    local_cycles = cpu_get_cycles() - local_cycles;
+
+    if (cpu_has_cycles()) {
+        printf("\n%d calls plt: %lu cycles local: %lu cycles\n",
+                EX_DYN_TEST_CALL_COUNT, plt_cycles, local_cycles);
+    }
+    if (sum) {
+        printf("Error: plt and local results do not match\n");
+        swbkpt();
+    }
+}
+
+static size_t ex_dyn_test_heap_in_use;
+
+static void ex_dyn_test_heap_account(const void *caller, size_t size,
+        int alloc)
+{
+    if (alloc) {
+        ex_dyn_test_heap_in_use += size;
+    } else {
+        ex_dyn_test_heap_in_use -= size;
+    }
+}
+
+void ex_dyn_test_heap(void)
+{
+    struct heap scratch;
+    void *scratch_base;
+    void *a;
+    void *b;
+    void *c;
+
+    printf("\nheap_default: 0x%p - 0x%p free: %d\n", heap_default.base,
+            heap_default.end, (int)heap_get_free_size(&heap_default));
+    heap_set_account(&heap_default, ex_dyn_test_heap_account);
+
+    // Freed blocks are reused by the next allocation of the same class.
+    a = heap_alloc(&heap_default, 20);
+    b = heap_alloc(&heap_default, 300);
+    heap_free(&heap_default, a, 20);
+    c = heap_alloc(&heap_default, 24);
+    printf("a: 0x%p b: 0x%p c: 0x%p in use: %d\n", a, b, c,
+            (int)ex_dyn_test_heap_in_use);
+    if (a != c) {
+        printf("Error: size class block was not reused\n");
+        swbkpt();
+    }
+
+    // Transient arena carved from heap_default and released at once.
+    scratch_base = heap_alloc(&heap_default, 512);
+    heap_init(&scratch, scratch_base, scratch_base ? 512 : 0);
+    heap_alloc(&scratch, 100);
+    heap_alloc(&scratch, 200);
+    printf("scratch free: %d", (int)heap_get_free_size(&scratch));
+    heap_reset(&scratch);
+    printf(" after reset: %d\n", (int)heap_get_free_size(&scratch));
+
+    // Large blocks return to the arena when freed in reverse order.
+    heap_free(&heap_default, scratch_base, 512);
+    heap_free(&heap_default, c, 24);
+    heap_free(&heap_default, b, 300);
+    heap_set_account(&heap_default, NULL);
+}
+
+// Kept in flash, the loader writes the pointer with cpu_flash_write.
+static struct ex_ftable * const ex_dyn_test_ftable_list[] __flash_rel = {
+    &ex_ftable,
+};
+
 void ex_dyn_test_libftable(void)
 {
     int (*func_c)(int) = ex_ftable_func_c;
@@ -85,6 +285,10 @@ void ex_dyn_test_libftable(void)
     print_ex_ftable();
     print_ex_ftable_ptr();
 
+    printf("** using libftable via flash table [<%p>]...\n",
+            ex_dyn_test_ftable_list);
+    ex_dyn_test_ftable_list[0]->ptr_c(9);
+
     putchar('\n');
 }
 
@@ -182,6 +386,39 @@ void ex_dyn_test_libgarage(void)
     ex_garage_print_call_counts();
 }
 
+// Replace libprint.so used by libgarage.so with libprint2.so.
+void ex_dyn_test_swap(void)
+{
+    int ret;
+
+    mystery_func();
+    ret = uld_swap("libprint.so", "libprint2.so");
+    printf("swap libprint.so libprint2.so: %d\n", ret);
+    if (ret) {
+        swbkpt();
+        return;
+    }
+    // ex_garage_print_banner and mystery_func now use libprint2.so.
+    ex_garage_print_banner();
+    mystery_func();
+}
+
+// Patch ex_print_lower of libprint2.so with libprint_patch.so.  libgarage.so
+// prints through the patched function afterwards.
+void ex_dyn_test_patch(void)
+{
+    int ret;
+
+    ret = uld_patch("libprint_patch.so", "libprint2.so");
+    printf("patch libprint_patch.so libprint2.so: %d\n", ret);
+    if (ret) {
+        swbkpt();
+        return;
+    }
+    ex_garage_print_truck_count();
+    ex_garage_print_car_count();
+}
+
 int main(int argc, char **argv)
 {
     uint32_t pc = cpu_get_pc();
@@ -209,7 +446,17 @@ int main(int argc, char **argv)
 
     ex_dyn_test_libgarage();
 
-    mystery_func();
+    ex_dyn_test_ramfunc();
+
+    ex_dyn_test_plt();
+
+    ex_dyn_test_irq();
+
+    ex_dyn_test_heap();
+
+    ex_dyn_test_swap();
+
+    ex_dyn_test_patch();
 
     swbkpt();
     while (1);
@@ -37,10 +37,18 @@ int ex_print_dl_alloc_a __export;
 int ex_print_dl_alloc_b __export;
 int ex_print_dl_alloc_c __export;
 
+// libprint2.so is built with EX_PRINT_V2 as a new version of libprint.so
+// for uld_swap.
 static const char moo_str[] =
+#ifdef EX_PRINT_V2
+    " _________\n"
+    "< moo v2! >\n"
+    " ---------\n"
+#else
     " ______\n"
     "< moo! >\n"
     " ------\n"
+#endif
     "        \\   ^__^\n"
     "         \\  (oo)\\_______\n"
     "            (__)\\       )\\/\\\n"
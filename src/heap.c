@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "heap.h"
+
+
+struct heap heap_default __export;
+
+
+static size_t heap_align_size(size_t size)
+{
+    return (ALIGN(size, HEAP_ALIGNMENT));
+}
+
+// Size class index for size or -1 if larger than HEAP_CLASS_MAX.
+static int heap_get_class(size_t size)
+{
+    int idx = 0;
+
+    if (size > HEAP_CLASS_MAX) {
+        return -1;
+    }
+
+    while ((size_t)1 << (HEAP_CLASS_MIN_SHIFT + idx) < size) {
+        idx++;
+    }
+
+    return idx;
+}
+
+__export void heap_init(struct heap *h, void *base, size_t size)
+{
+    h->base = ALIGN_PTR((uint8_t *)base, HEAP_ALIGNMENT);
+    h->end = (uint8_t *)base + size;
+    if (!base || h->end < h->base) {
+        h->end = h->base;
+    }
+    h->account = NULL;
+    heap_reset(h);
+}
+
+__export void heap_reset(struct heap *h)
+{
+    h->ptr = h->base;
+    memset(h->free_list, 0, sizeof(h->free_list));
+}
+
+__export void *heap_alloc(struct heap *h, size_t size)
+{
+    struct heap_block *block;
+    void *ptr;
+    int idx;
+
+    if (!size) {
+        return NULL;
+    }
+
+    idx = heap_get_class(size);
+    if (idx >= 0) {
+        size = (size_t)1 << (HEAP_CLASS_MIN_SHIFT + idx);
+        block = h->free_list[idx];
+        if (block) {
+            h->free_list[idx] = block->next;
+            ptr = block;
+            goto out;
+        }
+    } else {
+        size = heap_align_size(size);
+    }
+
+    if ((size_t)(h->end - h->ptr) < size) {
+        return NULL;
+    }
+    ptr = h->ptr;
+    h->ptr += size;
+
+out:
+    if (h->account) {
+        h->account(__builtin_return_address(0), size, 1);
+    }
+    return ptr;
+}
+
+__export void heap_free(struct heap *h, void *ptr, size_t size)
+{
+    struct heap_block *block = ptr;
+    int idx;
+
+    if (!ptr || !size) {
+        return;
+    }
+
+    idx = heap_get_class(size);
+    if (idx >= 0) {
+        size = (size_t)1 << (HEAP_CLASS_MIN_SHIFT + idx);
+        block->next = h->free_list[idx];
+        h->free_list[idx] = block;
+    } else {
+        // Large blocks only go back to the arena if they are the last
+        // allocation, otherwise they are reclaimed by heap_reset.
+        size = heap_align_size(size);
+        if ((uint8_t *)ptr + size == h->ptr) {
+            h->ptr = ptr;
+        }
+    }
+
+    if (h->account) {
+        h->account(__builtin_return_address(0), size, 0);
+    }
+}
+
+__export size_t heap_get_free_size(const struct heap *h)
+{
+    return h->end - h->ptr;
+}
+
+__export void heap_set_account(struct heap *h, heap_account_f account)
+{
+    h->account = account;
+}
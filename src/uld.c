@@ -26,97 +26,133 @@
 #include "uld_reloc.h"
 
 
-int uld_main(void)
-{
-    const void *ufile_dest;
-    const struct uld_fs_entry *exec_fse;
-    const struct uld_fs_entry *move_fse;
-    const char *rv[5];
-    const char **argv = NULL;
+struct uld_main_args {
     const char *exec_name;
-    const char *move_name = NULL;
-    void *sp_base = NULL;
-    int argc = 0;
+    // Additional programs run with exec_name (see uld_dyn_exec_fse_list).
+    const char *exec_list[ULD_DYN_PROGRAM_MAX - 1];
+    int exec_list_count;
+    const char *move_name;
+    void *sp_base;
+    int argc;
+    const char **argv;
+    const char *rv[5];
+};
 
 
-    switch (ULD_PSTORE->boot_action) {
+static void uld_main_select(uint32_t action, struct uld_main_args *args)
+{
+    memset(args, 0, sizeof(struct uld_main_args));
+
+    switch (action) {
     case 0:
-        exec_name = "hello_world_static.elf";
+        args->exec_name = "hello_world_static.elf";
         break;
 
     case 1:
         uld_verbose = 1;
-        exec_name = "hello_world.elf";
-        rv[0] = "foo";
-        rv[1] = "bar";
-        rv[2] = NULL;
-        argv = rv;
-        argc = 2;
+        args->exec_name = "hello_world.elf";
+        args->rv[0] = "foo";
+        args->rv[1] = "bar";
+        args->rv[2] = NULL;
+        args->argv = args->rv;
+        args->argc = 2;
 
     case 2:
-        exec_name = "hello_world.elf";
-        move_name = exec_name;
-        rv[0] = "moved";
-        rv[1] = "hello";
-        rv[2] = "world";
-        rv[3] = NULL;
-        argv = rv;
-        argc = 3;
+        args->exec_name = "hello_world.elf";
+        args->move_name = args->exec_name;
+        args->rv[0] = "moved";
+        args->rv[1] = "hello";
+        args->rv[2] = "world";
+        args->rv[3] = NULL;
+        args->argv = args->rv;
+        args->argc = 3;
         break;
 
     case 3:
-        exec_name = "dyn_test.elf";
-        rv[0] = "woof";
-        rv[1] = "bark";
-        rv[2] = NULL;
-        argv = rv;
-        argc = 2;
+        args->exec_name = "dyn_test.elf";
+        args->rv[0] = "woof";
+        args->rv[1] = "bark";
+        args->rv[2] = NULL;
+        args->argv = args->rv;
+        args->argc = 2;
         break;
 
     case 4:
         uld_verbose = 2;
-        exec_name = "dyn_test.elf";
+        args->exec_name = "dyn_test.elf";
         break;
 
     case 5:
         uld_verbose = 1;
-        exec_name = "dyn_test.elf";
-        move_name = "libexc.so";
-        rv[0] = "moved";
-        rv[1] = "libexc.so";
-        rv[2] = NULL;
-        argv = rv;
-        argc = 2;
+        args->exec_name = "dyn_test.elf";
+        args->move_name = "libexc.so";
+        args->rv[0] = "moved";
+        args->rv[1] = "libexc.so";
+        args->rv[2] = NULL;
+        args->argv = args->rv;
+        args->argc = 2;
         break;
 
     case 6:
-        sp_base = ESTACK;
-        exec_name = "dyn_test.elf";
-        rv[0] = "stack";
-        rv[1] = "reset";
-        rv[2] = NULL;
-        argv = rv;
-        argc = 2;
+        args->sp_base = ESTACK;
+        args->exec_name = "dyn_test.elf";
+        args->rv[0] = "stack";
+        args->rv[1] = "reset";
+        args->rv[2] = NULL;
+        args->argv = args->rv;
+        args->argc = 2;
+        break;
+
+    case 7:
+        args->exec_name = "dl_test.elf";
+        break;
+
+    case 8:
+        uld_verbose = 1;
+        args->exec_name = "dyn_test.elf";
+        args->exec_list[0] = "hello_world.elf";
+        args->exec_list_count = 1;
         break;
 
     default:
-        printf("invalid boot_action: %ld\n", ULD_PSTORE->boot_action);
+        printf("invalid boot_action: %ld\n", action);
         swbkpt();
         break;
     }
+}
 
-    exec_fse = uld_fs_get_file_by_name(ULD_PSTORE->fs_table_pri.head,
-            exec_name);
+static const struct uld_fs_entry *uld_main_get_exec_fse(const char *name)
+{
+    const struct uld_fs_entry *exec_fse;
+
+    exec_fse = uld_fs_get_file_by_name(ULD_PSTORE->fs_table_pri.head, name);
     if (!exec_fse) {
-        printf("could not find exec file: %s\n", exec_name);
+        printf("could not find exec file: %s\n", name);
         swbkpt();
     }
 
-    if (move_name) {
+    return exec_fse;
+}
+
+int uld_main(void)
+{
+    struct uld_main_args args;
+    const void *ufile_dest;
+    const struct uld_fs_entry *exec_fse;
+    const struct uld_fs_entry *move_fse;
+    const struct uld_fs_entry *fse_list[ULD_DYN_PROGRAM_MAX];
+    uint32_t action;
+    int i;
+
+    action = ULD_PSTORE->boot_action;
+    uld_main_select(action, &args);
+    exec_fse = uld_main_get_exec_fse(args.exec_name);
+
+    if (args.move_name) {
         move_fse = uld_fs_get_file_by_name(ULD_PSTORE->fs_table_pri.head,
-                move_name);
+                args.move_name);
         if (!move_fse) {
-            printf("could not find move file: %s\n", move_name);
+            printf("could not find move file: %s\n", args.move_name);
             swbkpt();
         }
         ufile_dest = uld_fs_find_free_space(ULD_PSTORE, move_fse->size);
@@ -127,7 +163,46 @@ int uld_main(void)
         uld_reloc_move_fse(move_fse, ufile_dest);
     }
 
-    uld_dyn_exec_fse(exec_fse, sp_base, argc, argv);
+    if (args.exec_list_count) {
+        fse_list[0] = exec_fse;
+        for (i = 0; i < args.exec_list_count; i++) {
+            fse_list[i + 1] = uld_main_get_exec_fse(args.exec_list[i]);
+        }
+        uld_dyn_exec_fse_list(fse_list, args.exec_list_count + 1, args.argc,
+                args.argv);
+        swbkpt();
+        while (1);
+    }
+
+    if (uld_dyn_exec_fse(exec_fse, args.sp_base, args.argc, args.argv)) {
+        printf("could not execute %s\n", exec_fse->name);
+        swbkpt();
+        while (1);
+    }
+
+    // When the executable returns alternate between chain_action and
+    // boot_action keeping shared libraries loaded.  An executable that reset
+    // the stack can not return here.
+    while (ULD_PSTORE->chain_action != ULD_PSTORE_CHAIN_NONE &&
+            !args.sp_base) {
+        if (action == ULD_PSTORE->chain_action) {
+            action = ULD_PSTORE->boot_action;
+        } else {
+            action = ULD_PSTORE->chain_action;
+        }
+        printf("\nchaining boot_action: %ld\n", action);
+
+        // Files are only moved at boot.
+        uld_main_select(action, &args);
+        if (args.sp_base) {
+            printf("chain: stack reset not supported\n");
+            args.sp_base = NULL;
+        }
+        exec_fse = uld_main_get_exec_fse(args.exec_name);
+        if (uld_dyn_chain_fse(exec_fse, args.argc, args.argv)) {
+            break;
+        }
+    }
 
     swbkpt();
     while (1);
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+#include "uld.h"
+#include "elf.h"
+#include "uld_audit.h"
+
+
+#ifdef ULD_AUDIT
+
+const struct uld_audit_ops *uld_audit_ops;
+struct uld_audit_stats uld_audit_stats;
+
+
+// Returns the stats index for fse, adding it if there is space, or -1.
+static int uld_audit_get_file_idx(const struct uld_fs_entry *fse)
+{
+    struct uld_audit_stats *st = &uld_audit_stats;
+    int i;
+
+    for (i = 0; i < ULD_AUDIT_FILE_MAX; i++) {
+        if (st->file[i].fse == fse) {
+            return i;
+        }
+        if (!st->file[i].fse) {
+            st->file[i].fse = fse;
+            return i;
+        }
+    }
+
+    st->dropped++;
+    return -1;
+}
+
+static void uld_audit_stats_file_loaded(const struct uld_file *ufile)
+{
+    int idx;
+
+    idx = uld_audit_get_file_idx(ufile->fse);
+    if (idx >= 0) {
+        uld_audit_stats.file[idx].load_count++;
+    }
+}
+
+static void uld_audit_stats_sym_bound(const struct uld_file *req,
+        const struct uld_file *prov, const char *name, unsigned int rel_type,
+        int lookups)
+{
+    struct uld_audit_stats *st = &uld_audit_stats;
+    struct uld_audit_bind *bind;
+    int req_idx;
+    int prov_idx;
+
+    switch (rel_type) {
+    case R_ARM_ABS32:
+        st->rel_count[ULD_AUDIT_REL_IDX_ABS32]++;
+        break;
+    case R_ARM_GLOB_DAT:
+        st->rel_count[ULD_AUDIT_REL_IDX_GLOB_DAT]++;
+        break;
+    case R_ARM_FUNCDESC:
+        st->rel_count[ULD_AUDIT_REL_IDX_FUNCDESC]++;
+        break;
+    case R_ARM_FUNCDESC_VALUE:
+        st->rel_count[ULD_AUDIT_REL_IDX_FUNCDESC_VALUE]++;
+        break;
+    }
+
+    st->lookups += lookups;
+    if (lookups > st->max_lookups) {
+        st->max_lookups = lookups;
+        st->max_lookups_name = name;
+    }
+
+    req_idx = uld_audit_get_file_idx(req->fse);
+    prov_idx = uld_audit_get_file_idx(prov->fse);
+    if (req_idx < 0 || prov_idx < 0) {
+        return;
+    }
+
+    // Saturate, the counts are only used to rank bindings.
+    bind = &st->bind[req_idx][prov_idx];
+    if (bind->count != 0xffff) {
+        bind->count++;
+    }
+    if (bind->lookups <= 0xffff - lookups) {
+        bind->lookups += lookups;
+    } else {
+        bind->lookups = 0xffff;
+    }
+}
+
+static void uld_audit_stats_funcdesc_alloc(const struct uld_file *req,
+        const struct uld_file *prov, const void *fd)
+{
+    int idx;
+
+    idx = uld_audit_get_file_idx(req->fse);
+    if (idx >= 0) {
+        uld_audit_stats.file[idx].funcdesc_count++;
+    }
+}
+
+static void uld_audit_stats_init_run(const struct uld_file *ufile,
+        uint32_t cycles)
+{
+    int idx;
+
+    idx = uld_audit_get_file_idx(ufile->fse);
+    if (idx >= 0) {
+        uld_audit_stats.file[idx].init_cycles += cycles;
+    }
+}
+
+const struct uld_audit_ops uld_audit_stats_ops = {
+    .file_loaded = uld_audit_stats_file_loaded,
+    .sym_bound = uld_audit_stats_sym_bound,
+    .funcdesc_alloc = uld_audit_stats_funcdesc_alloc,
+    .init_run = uld_audit_stats_init_run,
+};
+
+
+void uld_audit_set_ops(const struct uld_audit_ops *ops)
+{
+    uld_audit_ops = ops;
+}
+
+void uld_audit_init(void)
+{
+    memset(&uld_audit_stats, 0, sizeof(struct uld_audit_stats));
+    uld_audit_set_ops(&uld_audit_stats_ops);
+}
+
+#endif  // ULD_AUDIT
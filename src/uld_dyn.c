@@ -23,12 +23,24 @@
 #include <alloca.h>
 
 #include "uld.h"
+#include "cpu.h"
+#include "heap.h"
+#include "uld_audit.h"
 #include "uld_dyn.h"
 #include "uld_exec.h"
 #include "uld_file.h"
+#include "uld_flat.h"
 #include "uld_fs.h"
+#include "uld_irq.h"
 #include "uld_load.h"
+#include "uld_mem.h"
+#include "uld_reloc.h"
 #include "uld_sal.h"
+#include "uld_sched.h"
+#include "uld_snap.h"
+#include "uld_svc.h"
+#include "uld_warm.h"
+#include "util.h"
 
 
 #if ULD_DYN_VERBOSE == 1
@@ -86,9 +98,22 @@ struct uld_dyn_resolution {
     uint8_t *membase;
     const struct elf32_sym *match_sym;
     int file_idx;
+    // Hash table lookups done by uld_dyn_resolve_rel (see uld_audit.h).
+    int lookups;
 };
 
 
+#if defined(ULD_HOST)
+// The host link places uld_dyn_state at its uld.elf address so the pointers
+// saved by uld_flat_save are valid on the target (see scripts/uld-prelink.c).
+#elif defined(ULD_WARM_RESET)
+// Kept across warm resets, cleared by uld_dyn_exec_fse on a cold start.
+struct uld_dyn_state uld_dyn_state __section(".bss.noinit.uld_dyn_state");
+#else
+struct uld_dyn_state uld_dyn_state;
+#endif
+
+
 unsigned long uld_dyn_elf_hash(const unsigned char *name)
 {
     unsigned long h = 0;
@@ -198,6 +223,50 @@ const struct elf32_sym *uld_dyn_find_dynsym_linear_file(const char *name,
     return uld_dyn_find_dynsym_linear_sec(name, dynstr_sec, dynsym_sec);
 }
 
+static int uld_dyn_create_fse_section(const struct elf32_ehdr *ehdr,
+        const void *shstrtab_faddr, const char *name,
+        struct uld_section *section)
+{
+    const struct elf32_shdr *shdr;
+
+    shdr = elf32_get_section_by_name_shstrtab_faddr(ehdr, NULL, name,
+            shstrtab_faddr);
+    if (!shdr) {
+        return -1;
+    }
+
+    return uld_load_create_section(section, ehdr, NULL, shdr, 0,
+            shstrtab_faddr);
+}
+
+// Search the dynamic symbol table of a file that has not been loaded.
+static const struct elf32_sym *uld_dyn_find_dynsym_elf_hash_fse(
+        const char *name, const struct uld_fs_entry *fse)
+{
+    const struct elf32_ehdr *ehdr = fse->base;
+    const struct elf32_shdr *shstrtab;
+    const void *shstrtab_faddr;
+    struct uld_section hash_sec;
+    struct uld_section dynstr_sec;
+    struct uld_section dynsym_sec;
+
+    shstrtab = elf32_get_section_by_index(ehdr, NULL, (int)ehdr->e_shstrndx);
+    shstrtab_faddr = elf32_get_section_flash_addr(shstrtab,
+            (const void *)ehdr);
+
+    if (uld_dyn_create_fse_section(ehdr, shstrtab_faddr, ".hash",
+            &hash_sec) ||
+            uld_dyn_create_fse_section(ehdr, shstrtab_faddr, ".dynstr",
+            &dynstr_sec) ||
+            uld_dyn_create_fse_section(ehdr, shstrtab_faddr, ".dynsym",
+            &dynsym_sec)) {
+        return NULL;
+    }
+
+    return uld_dyn_find_dynsym_elf_hash_sec(name, &hash_sec, &dynstr_sec,
+            &dynsym_sec);
+}
+
 static int uld_dyn_create_fse_dep_list_get_sections(
         const struct uld_fs_entry *fse,
         struct uld_section *dyn_sec,
@@ -240,8 +309,64 @@ static int uld_dyn_create_fse_dep_list_get_sections(
     return ret;
 }
 
-int uld_dyn_create_fse_dep_list(const struct uld_fs_entry *fse,
-        const struct uld_fs_entry **dep_list, int *idx, int list_size)
+static int uld_dyn_add_lazy_fse(const struct uld_fs_entry *fse,
+        const struct uld_fs_entry **lazy_fse, int *lazy_count)
+{
+    int i;
+
+    for (i = 0; i < *lazy_count; i++) {
+        if (lazy_fse[i] == fse) {
+            return 0;
+        }
+    }
+
+    if (*lazy_count == ULD_DYN_LAZY_FILE_MAX) {
+        return -2;
+    }
+
+    lazy_fse[(*lazy_count)++] = fse;
+
+    return 0;
+}
+
+static int uld_dyn_fse_has_func(const struct uld_fs_entry *fse,
+        const char *name)
+{
+    const struct elf32_sym *sym;
+
+    sym = uld_dyn_find_dynsym_elf_hash_fse(name, fse);
+
+    return sym && elf32_sym_has_section_index(sym) &&
+            ELF32_ST_TYPE(sym->st_info) == STT_FUNC;
+}
+
+// Lazy libraries found at load time then overlay members.
+static const struct uld_fs_entry *uld_dyn_find_lazy_fse(const char *name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry *pos;
+    int i;
+
+    for (i = 0; i < ds->lazy_count; i++) {
+        if (uld_dyn_fse_has_func(ds->lazy_fse[i], name)) {
+            return ds->lazy_fse[i];
+        }
+    }
+
+    fst_for_each_entry(pos, uld_fs_get_fst_head()) {
+        if (uld_fs_get_overlay(pos) && uld_dyn_fse_has_func(pos, name)) {
+            return pos;
+        }
+    }
+
+    return NULL;
+}
+
+// If lazy_fse is not NULL dependencies marked ULD_FS_ENTRY_FLAG_LAZY are
+// added to lazy_fse instead of dep_list and not followed.
+static int uld_dyn_create_fse_dep_list_lazy(const struct uld_fs_entry *fse,
+        const struct uld_fs_entry **dep_list, int *idx, int list_size,
+        const struct uld_fs_entry **lazy_fse, int *lazy_count)
 {
     struct uld_section dyn_sec;
     struct uld_section dynstr_sec;
@@ -276,8 +401,22 @@ int uld_dyn_create_fse_dep_list(const struct uld_fs_entry *fse,
                 return -1;
             }
 
-            ret = uld_dyn_create_fse_dep_list(dep_fse, dep_list, idx,
-                    list_size);
+            // Overlay members are only loaded through uld_dyn_lazy_stub or
+            // uld_dyn_overlay (see uld_dyn_find_lazy_fse).
+            if (uld_fs_get_overlay(dep_fse)) {
+                continue;
+            }
+
+            if (lazy_fse && (dep_fse->flags & ULD_FS_ENTRY_FLAG_LAZY)) {
+                ret = uld_dyn_add_lazy_fse(dep_fse, lazy_fse, lazy_count);
+                if (ret) {
+                    return ret;
+                }
+                continue;
+            }
+
+            ret = uld_dyn_create_fse_dep_list_lazy(dep_fse, dep_list, idx,
+                    list_size, lazy_fse, lazy_count);
             if (ret) {
                 return ret;
             }
@@ -294,6 +433,88 @@ int uld_dyn_create_fse_dep_list(const struct uld_fs_entry *fse,
     return 0;
 }
 
+// Returns the fs entry for the nth name in ULD_PSTORE->preload or NULL if
+// there are fewer names.  Erased flash (0xff) ends the list.
+static const struct uld_fs_entry *uld_dyn_get_preload_fse(int n)
+{
+    const char *pos = ULD_PSTORE->preload;
+    const char *end = pos + ULD_PSTORE_PRELOAD_SIZE;
+    const struct uld_fs_entry *fse;
+    char name[ULD_PSTORE_PRELOAD_SIZE];
+    size_t len;
+
+    while (pos < end && *pos && *pos != (char)0xff) {
+        len = 0;
+        while (pos + len < end && pos[len] && pos[len] != (char)0xff &&
+                pos[len] != ' ' && pos[len] != ',') {
+            len++;
+        }
+
+        if (len && !n--) {
+            memcpy(name, pos, len);
+            name[len] = '\0';
+            fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), name);
+            if (!fse) {
+                printf("could not find preload file: %s\n", name);
+            }
+            return fse;
+        }
+
+        pos += len;
+        if (pos < end && (*pos == ' ' || *pos == ',')) {
+            pos++;
+        }
+    }
+
+    return NULL;
+}
+
+// Add preload modules and their dependencies to dep_list ahead of the
+// executable.
+static int uld_dyn_create_preload_dep_list(
+        const struct uld_fs_entry **dep_list, int *idx, int list_size,
+        const struct uld_fs_entry **lazy_fse, int *lazy_count)
+{
+    const struct uld_fs_entry *fse;
+    int ret;
+    int n;
+
+    for (n = 0; (fse = uld_dyn_get_preload_fse(n)); n++) {
+        ret = uld_dyn_create_fse_dep_list_lazy(fse, dep_list, idx, list_size,
+                lazy_fse, lazy_count);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+static void uld_dyn_mark_preload(struct uld_file *ufile_list, int file_count)
+{
+    const struct uld_fs_entry *fse;
+    int i;
+    int n;
+
+    for (n = 0; (fse = uld_dyn_get_preload_fse(n)); n++) {
+        for (i = 0; i < file_count; i++) {
+            if (ufile_list[i].fse == fse) {
+                ufile_list[i].flags |= ULD_FILE_FLAG_PRELOAD;
+                if (uld_verbose) {
+                    printf("preload: %s\n", fse->name);
+                }
+            }
+        }
+    }
+}
+
+int uld_dyn_create_fse_dep_list(const struct uld_fs_entry *fse,
+        const struct uld_fs_entry **dep_list, int *idx, int list_size)
+{
+    return uld_dyn_create_fse_dep_list_lazy(fse, dep_list, idx, list_size,
+            NULL, NULL);
+}
+
 int uld_dyn_get_fse_dep_count(const struct uld_fs_entry *fse)
 {
     const struct uld_fs_entry **dep_list;
@@ -331,74 +552,108 @@ int uld_dyn_get_dep_list_sec_count(const struct uld_fs_entry **dep_list,
     return count;
 }
 
+// Allocate the window of fse's overlay group if needed.  Returns -1 if
+// there is not enough memory.
+static int uld_dyn_get_overlay_window(const struct uld_fs_entry *fse,
+        uint8_t **base)
+{
+    struct uld_dyn_overlay *ov;
+    const struct uld_fs_entry *pos;
+    unsigned int group;
+    size_t size;
+    size_t memsz;
+
+    group = uld_fs_get_overlay(fse);
+    ov = &uld_dyn_state.overlay[group - 1];
+    if (!ov->size) {
+        // Sized for the largest member so any member can be swapped in.
+        size = 0;
+        fst_for_each_entry(pos, uld_fs_get_fst_head()) {
+            if (uld_fs_get_overlay(pos) != group) {
+                continue;
+            }
+            memsz = uld_load_get_fse_mem_size(pos);
+            if (memsz > size) {
+                size = memsz;
+            }
+        }
+
+        if (size) {
+            ov->base = uld_mem_alloc(size);
+            if (!ov->base) {
+                printf("could not allocate %d bytes for overlay %u\n",
+                        (int)size, group);
+                return -1;
+            }
+        }
+        ov->size = size;
+        printf("overlay %u: window 0x%p size %d\n", group, ov->base,
+                (int)size);
+    }
+
+    *base = ov->base;
+
+    return 0;
+}
+
 int uld_dyn_load_fse_dep_list(const struct uld_fs_entry **dep_list,
         int dep_count, struct uld_file *ufile_list,
-        struct uld_section *sec_list, int sec_count, uint8_t **membase,
-        size_t *allocated)
+        struct uld_section *sec_list, int sec_count)
 {
-    uint8_t *load_file_membase;
-    size_t load_file_allocated;
+    uint8_t *membase;
+    unsigned int group;
     int i;
     int sec_idx;
     int ret;
 
     if (!dep_list || dep_count < 0 || !ufile_list || !sec_list ||
-            sec_count < 0 || !membase || !allocated) {
+            sec_count < 0) {
         return -1;
     }
 
     memset(ufile_list, 0, sizeof(struct uld_file) * dep_count);
     memset(sec_list, 0, sizeof(struct uld_section) * sec_count);
 
-    load_file_allocated = 0;
-    // Init/align membase for the first file to load.
-    *membase = uld_load_get_next_membase(*membase, 0);
-    load_file_membase = *membase;
-
     sec_idx = 0;
     for (i = 0; i < dep_count; i++) {
-        ret = uld_load_file(dep_list[i], &sec_list[sec_idx],
-                sec_count - sec_idx, ULD_DYN_LOAD_SECTION_TYPE_MASK,
-                &load_file_membase, &load_file_allocated, &ufile_list[i]);
+        membase = NULL;
+        group = uld_fs_get_overlay(dep_list[i]);
+        ret = group ? uld_dyn_get_overlay_window(dep_list[i], &membase) : 0;
+        if (!ret) {
+            ret = uld_load_file_at(dep_list[i], &sec_list[sec_idx],
+                    sec_count - sec_idx, ULD_DYN_LOAD_SECTION_TYPE_MASK,
+                    membase, &ufile_list[i]);
+        }
 
         if (ret) {
+            // Include the file that failed, membase is NULL if not
+            // allocated.  Overlay windows are kept.
+            for (; i >= 0; i--) {
+                group = uld_fs_get_overlay(dep_list[i]);
+                if (group) {
+                    uld_dyn_state.overlay[group - 1].active = NULL;
+                } else {
+                    uld_mem_free(ufile_list[i].membase, ufile_list[i].memsz);
+                }
+                uld_load_free_text(&ufile_list[i]);
+            }
             swbkpt();
             return ret;
         }
 
+        if (group) {
+            ufile_list[i].flags |= ULD_FILE_FLAG_OVERLAY;
+            uld_dyn_state.overlay[group - 1].active = dep_list[i];
+        }
+
         printf("loaded: %-16s mem base: 0x%p mem size: %d\n",
-                dep_list[i]->name, load_file_membase, load_file_allocated);
+                dep_list[i]->name, ufile_list[i].membase,
+                ufile_list[i].memsz);
+        uld_audit(file_loaded, &ufile_list[i]);
 
         sec_idx += uld_file_get_sec_count(&ufile_list[i]);
     }
 
-    *allocated = load_file_membase - *membase + load_file_allocated;
-
-    return 0;
-}
-
-static int uld_dyn_update_relative(const struct uld_file *ufile,
-        const struct elf32_rel *rel)
-{
-    void **rel_ptr;
-    void *ptr;
-    void *adj_ptr;
-
-    rel_ptr = (void **)uld_file_lma_to_adjusted_vma(ufile,
-            (void *)rel->r_offset);
-    if (!rel_ptr) {
-        uprintf("  Could not find vma for rel %p offset %p\n",
-                rel, (void *)rel->r_offset);
-        swbkpt();
-        return -1;
-    }
-
-    ptr = *rel_ptr;
-    adj_ptr = (void *)uld_file_lma_to_adjusted_vma(ufile, ptr);
-    *rel_ptr = adj_ptr;
-
-    uprintf("  Updating RELATIVE %p -> %p at %p\n", ptr, adj_ptr, rel_ptr);
-
     return 0;
 }
 
@@ -435,6 +690,11 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
     const struct elf32_rel *search_rel;
     const char *rel_sym_name;
     void *adj_vma;
+    int order[ULD_DYN_FILE_MAX];
+    int order_count;
+    int order_idx;
+    int instance;
+    int i;
     unsigned int rel_type;
     unsigned int match_sym_type;
     unsigned int match_sym_idx;
@@ -444,12 +704,14 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
     // with a symbol or existing relocation in the same file and checked
     // before returning.
     res->ptr = NULL;
+    res->lookups = 0;
 
     // Initialize search variables for file containing the relocation before
     // entering search the loop.  Allows searching in reverse starting
     // at the relocation directly before the one to resolve (excluding
     // the FUNCDESC exception below).
     ufile = &ufile_list[file_idx];
+    instance = ufile->instance;
     uld_dyn_get_link_sections(ufile, &hash_sec, &rel_dyn_sec, &dynsym_sec,
             &dynstr_sec);
 
@@ -483,9 +745,42 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
     // Note: If a resolution for an object does not exist the dynamic linker
     // may allocate space and create one (outside of this function).  See
     // uld_dyn_write_reso_glob_dat.
-    for (; file_idx >= 0; file_idx--) {
+    // Search order is the file containing the relocation, preload modules
+    // (ULD_FILE_FLAG_PRELOAD) loaded before it, then the remaining files
+    // loaded before it in reverse order.  Preload modules resolve against
+    // each other in normal order.
+    order_count = 0;
+    order[order_count++] = file_idx;
+    if (!(ufile->flags & ULD_FILE_FLAG_PRELOAD)) {
+        for (i = 0; i < file_idx; i++) {
+            if (ufile_list[i].flags & ULD_FILE_FLAG_PRELOAD) {
+                order[order_count++] = i;
+            }
+        }
+    }
+    for (i = file_idx - 1; i >= 0; i--) {
+        if ((ufile->flags & ULD_FILE_FLAG_PRELOAD) ||
+                !(ufile_list[i].flags & ULD_FILE_FLAG_PRELOAD)) {
+            order[order_count++] = i;
+        }
+    }
+
+    for (order_idx = 0; order_idx < order_count; order_idx++) {
+        file_idx = order[order_idx];
         ufile = &ufile_list[file_idx];
 
+        // Other program instances are never searched.  The file containing
+        // the relocation is first so rd_idx is already reset.
+        if (ufile->instance != instance) {
+            continue;
+        }
+
+        // Overlay members may be evicted, imports from them are bound to
+        // uld_dyn_lazy_stub by the caller.
+        if (order_idx && (ufile->flags & ULD_FILE_FLAG_OVERLAY)) {
+            continue;
+        }
+
         // If rd_idx < 0, search entire file at file_idx in ufile_list.
         // This is may be set above to search the entire file containing
         // the relocation.
@@ -505,6 +800,7 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
 
             match_sym = uld_dyn_find_dynsym_elf_hash_sec(rel_sym_name,
                     hash_sec, dynstr_sec, dynsym_sec);
+            res->lookups++;
 
             // This file does not have a matching symbol, skip to next file.
             if (!match_sym) {
@@ -723,9 +1019,15 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
         // to allocate space for it preventing a resolution.
         // This may not be an issue due to unused variables being garbage
         // collected by the linker.  See uld_dyn_write_reso_glob_dat.
+        // Function imports may still be bound to a lazy library by the
+        // caller.
         if (rel_type != R_ARM_GLOB_DAT) {
             uprintf("  Resolution not found for %s\n", rel_sym_name);
-            swbkpt();
+            if ((rel_type != R_ARM_FUNCDESC &&
+                    rel_type != R_ARM_FUNCDESC_VALUE) ||
+                    !uld_dyn_find_lazy_fse(rel_sym_name)) {
+                swbkpt();
+            }
         }
         return -1;
     }
@@ -734,6 +1036,138 @@ static int uld_dyn_resolve_rel(const struct uld_file *ufile_list,
     return 0;
 }
 
+static int uld_dyn_rel_in_flash(const struct uld_file *ufile,
+        const struct elf32_rel *rel)
+{
+    return uld_section_find_in_lists_by_lma(&ufile->sec.flash,
+            &ufile->num.flash, 1, (const void *)rel->r_offset) != NULL;
+}
+
+// Store a resolved pointer.  Pointer tables in flash sections (see
+// __flash_rel) are written with cpu_flash_write, only if the value changed.
+static int uld_dyn_store_rel_dst(const struct uld_file *ufile,
+        const struct elf32_rel *rel, void **rel_dst, void *ptr)
+{
+    int was_locked;
+    int ret;
+
+    if (!uld_dyn_rel_in_flash(ufile, rel)) {
+        *rel_dst = ptr;
+        return 0;
+    }
+
+    if (*rel_dst == ptr) {
+        return 0;
+    }
+
+    was_locked = cpu_flash_is_locked();
+    if (was_locked) {
+        cpu_flash_unlock();
+    }
+    ret = cpu_flash_write(rel_dst, &ptr, sizeof(void *));
+    if (was_locked) {
+        cpu_flash_lock();
+    }
+
+    if (ret) {
+        printf("[<%p>] flash write failed at %p\n", rel, rel_dst);
+    }
+
+    return ret;
+}
+
+static int uld_dyn_update_relative(const struct uld_file *ufile,
+        const struct elf32_rel *rel)
+{
+    void **rel_ptr;
+    void *ptr;
+    void *adj_ptr;
+
+    rel_ptr = (void **)uld_file_lma_to_adjusted_vma(ufile,
+            (void *)rel->r_offset);
+    if (!rel_ptr) {
+        uprintf("  Could not find vma for rel %p offset %p\n",
+                rel, (void *)rel->r_offset);
+        swbkpt();
+        return -1;
+    }
+
+    ptr = *rel_ptr;
+
+    // A pointer in a flash section is adjusted once, when bound again it no
+    // longer holds a link address and is left as is.  It must point to the
+    // file's flash, memory sections move with the membase.
+    if (uld_dyn_rel_in_flash(ufile, rel) &&
+            !uld_section_find_in_lists_by_lma(&ufile->sec.flash,
+            &ufile->num.flash, 1, ptr)) {
+        if (uld_file_lma_to_adjusted_vma(ufile, ptr)) {
+            printf("[<%p>] RELATIVE in flash points to memory\n", rel);
+            return -1;
+        }
+        return 0;
+    }
+
+    adj_ptr = (void *)uld_file_lma_to_adjusted_vma(ufile, ptr);
+    uprintf("  Updating RELATIVE %p -> %p at %p\n", ptr, adj_ptr, rel_ptr);
+
+    return uld_dyn_store_rel_dst(ufile, rel, rel_ptr, adj_ptr);
+}
+
+// Stamp of everything the flash relocations of file_idx may resolve to: the
+// flash address, membase, flash descriptor table and crc of each file of its
+// program instance.  The file's own crc and table are left out, binding
+// changes its crc which rebuilds its table with the same descriptors.
+static uint32_t uld_dyn_calc_bind_stamp(const struct uld_file *ufile_list,
+        int file_idx, int file_count)
+{
+    const struct uld_file *ufile = &ufile_list[file_idx];
+    const void *val[4];
+    uint32_t crc = UTIL_CRC32_INIT;
+    int i;
+
+    for (i = 0; i < file_count; i++) {
+        if (ufile_list[i].instance != ufile->instance) {
+            continue;
+        }
+        val[0] = ufile_list[i].fse;
+        val[1] = ufile_list[i].fse->base;
+        val[2] = ufile_list[i].membase;
+        val[3] = NULL;
+        if (i != file_idx) {
+            val[3] = uld_reloc_get_fdtab(&ufile_list[i]);
+            crc = crc32(&ufile_list[i].fse->crc, sizeof(uint32_t), crc);
+        }
+        crc = crc32(val, sizeof(val), crc);
+    }
+
+    return crc;
+}
+
+// Update the crc of a file whose flash relocations were bound and record
+// the stamp they were bound with.
+static int uld_dyn_finish_flash_bind(const struct uld_file *ufile,
+        uint32_t stamp)
+{
+    int was_locked;
+
+    if (!uld_crc_verify_fse(ufile->fse, NULL)) {
+        was_locked = cpu_flash_is_locked();
+        if (was_locked) {
+            cpu_flash_unlock();
+        }
+        uld_crc_update_fse((struct uld_fs_entry *)ufile->fse, NULL);
+        uld_crc_update_fst(NULL);
+        if (was_locked) {
+            cpu_flash_lock();
+        }
+        // The table of the file was built for its previous crc, importers
+        // linked after it use the rebuilt one.
+        uld_reloc_update_fdtab(ufile, 1);
+    }
+
+    return uld_reloc_set_stamp(ufile->fse, stamp);
+}
+
 static int uld_dyn_write_reso_abs32(const struct uld_file *ufile_list,
         int file_idx, const struct elf32_rel *rel,
         const struct uld_dyn_resolution *res)
@@ -760,16 +1194,40 @@ static int uld_dyn_write_reso_abs32(const struct uld_file *ufile_list,
         ptr = res->ptr;
     }
 
-    *rel_dst = ptr;
+    if (uld_dyn_store_rel_dst(rel_ufile, rel, rel_dst, ptr)) {
+        return -1;
+    }
     uprintf("  Wrote ABS32 %p to %p\n", ptr, rel_dst);
 
     return 0;
 }
 
+// Take size bytes from the dl_alloc pool ending at dl_alloc_end.  Returns
+// NULL if the pool is exhausted, nothing is taken.
+static void *uld_dyn_dl_alloc(uint8_t **dl_alloc_base,
+        const uint8_t *dl_alloc_end, size_t size, size_t *dl_alloc_size)
+{
+    uint8_t *ptr = *dl_alloc_base;
+    uint8_t *next;
+
+    next = ALIGN_PTR(ptr + size, ULD_DYN_ALLOC_ALIGNMENT);
+    if (next > dl_alloc_end) {
+        printf("  dl_alloc pool overflow allocating %d bytes\n", (int)size);
+        swbkpt();
+        return NULL;
+    }
+
+    // Take alignment into account for real alloc size.
+    *dl_alloc_size += next - ptr;
+    *dl_alloc_base = next;
+
+    return ptr;
+}
+
 static int uld_dyn_write_reso_glob_dat(const struct uld_file *ufile_list,
         int file_idx, const struct elf32_rel *rel,
-        const struct uld_dyn_resolution *res,
-        uint8_t **dl_alloc_base, size_t *dl_alloc_size)
+        const struct uld_dyn_resolution *res, uint8_t **dl_alloc_base,
+        const uint8_t *dl_alloc_end, size_t *dl_alloc_size)
 {
     const struct uld_file *rel_ufile;
     const struct uld_file *res_ufile;
@@ -808,11 +1266,11 @@ static int uld_dyn_write_reso_glob_dat(const struct uld_file *ufile_list,
         }
         // Set the resolution pointer in the dl_alloc pool and allocate
         // space for it.
-        ptr = *dl_alloc_base;
-        *dl_alloc_base = ALIGN_PTR(ptr + res->match_sym->st_size,
-                ULD_DYN_ALLOC_ALIGNMENT);
-        // Take alignment into account for real alloc size.
-        *dl_alloc_size += *dl_alloc_base - (uint8_t *)ptr;
+        ptr = uld_dyn_dl_alloc(dl_alloc_base, dl_alloc_end,
+                (size_t)res->match_sym->st_size, dl_alloc_size);
+        if (!ptr) {
+            return -1;
+        }
 
         // Zero out allocated this memory (this behavior only seems to
         // happened for bss).  Would be more serious for .data since
@@ -857,10 +1315,12 @@ static void uld_dyn_write_reso_funcdesc_value_dst(void **dst,
 
 static int uld_dyn_write_reso_funcdesc(const struct uld_file *ufile_list,
         int file_idx, const struct elf32_rel *rel,
-        const struct uld_dyn_resolution *res,
-        uint8_t **dl_alloc_base, size_t *dl_alloc_size)
+        const struct uld_dyn_resolution *res, uint8_t **dl_alloc_base,
+        const uint8_t *dl_alloc_end, size_t *dl_alloc_size)
 {
+    const struct uld_dyn_funcdesc *fd;
     const struct uld_file *rel_ufile;
+    const struct uld_file *res_ufile;
     void **rel_dst;
     void *ptr;
 
@@ -874,20 +1334,41 @@ static int uld_dyn_write_reso_funcdesc(const struct uld_file *ufile_list,
         return -1;
     }
 
-    if (res->membase) {
-        ptr = *dl_alloc_base;
-
-        // Assumes alignment requirement <= 8 bytes.
-        *dl_alloc_base += 8;
-        *dl_alloc_size += 8;
+    res_ufile = &ufile_list[res->file_idx];
+    // Libraries with a fixed flash address and membase provide canonical
+    // descriptors in flash (see uld_reloc_update_fdtab).
+    fd = res->membase ? uld_reloc_get_fdtab_funcdesc(res_ufile,
+            uld_file_lma_to_adjusted_vma(res_ufile, res->ptr)) : NULL;
+
+    if (fd) {
+        ptr = (void *)fd;
+        uprintf("  Using flash FUNCDESC_VALUE %p\n", ptr);
+    } else if (res->membase && uld_dyn_rel_in_flash(rel_ufile, rel)) {
+        // Flash relocations are skipped once bound, a dl_alloc descriptor
+        // would not be allocated again.
+        printf("  FUNCDESC in flash needs a flash descriptor table for %s\n",
+                res_ufile->fse->name);
+        swbkpt();
+        return -1;
+    } else if (res->membase) {
+        // Assumes alignment requirement <= 8 bytes.
+        ptr = uld_dyn_dl_alloc(dl_alloc_base, dl_alloc_end, 8,
+                dl_alloc_size);
+        if (!ptr) {
+            return -1;
+        }
         uprintf("  Allocated 8 bytes for FUNCDESC_VALUE\n");
+        uld_audit(funcdesc_alloc, rel_ufile, &ufile_list[res->file_idx],
+                ptr);
 
         uld_dyn_write_reso_funcdesc_value_dst((void **)ptr, ufile_list, res);
     } else {
         ptr = res->ptr;
     }
 
-    *rel_dst = ptr;
+    if (uld_dyn_store_rel_dst(rel_ufile, rel, rel_dst, ptr)) {
+        return -1;
+    }
     uprintf("  Wrote FUNCDESC %p to %p\n", ptr, rel_dst);
     swbkpt_dyn();
 
@@ -938,28 +1419,145 @@ static int uld_dyn_write_reso_funcdesc_value(const struct uld_file *ufile_list,
     return 0;
 }
 
-int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
-        uint8_t *dl_alloc_base, size_t *dl_alloc_size)
+// Bind an unresolved FUNCDESC/FUNCDESC_VALUE relocation to uld_dyn_lazy_stub
+// if a lazy library provides the function.
+static int uld_dyn_write_lazy_import(const struct uld_file *ufile,
+        const struct elf32_rel *rel, uint8_t **dl_alloc_base,
+        const uint8_t *dl_alloc_end, size_t *dl_alloc_size)
+{
+    struct uld_dyn_lazy_import *import = NULL;
+    struct uld_section *dynsym_sec;
+    struct uld_section *dynstr_sec;
+    const struct elf32_sym *rel_sym;
+    const struct uld_fs_entry *fse;
+    const char *name;
+    void **rel_dst;
+    void **slot;
+    int i;
+
+    uld_dyn_get_link_sections(ufile, NULL, NULL, &dynsym_sec, &dynstr_sec);
+    rel_sym = uld_dyn_get_dynsym_by_index_sec(ELF32_R_SYM(rel->r_info),
+            dynsym_sec);
+    name = uld_dyn_get_sym_name(rel_sym, dynstr_sec);
+
+    fse = uld_dyn_find_lazy_fse(name);
+    if (!fse) {
+        return -1;
+    }
+
+    for (i = 0; i < ULD_DYN_LAZY_IMPORT_MAX; i++) {
+        if (!uld_dyn_state.lazy_import[i].fse) {
+            import = &uld_dyn_state.lazy_import[i];
+            break;
+        }
+    }
+    if (!import) {
+        printf("  lazy import table full\n");
+        swbkpt();
+        return -1;
+    }
+
+    rel_dst = (void **)uld_file_lma_to_adjusted_vma(ufile,
+            (void *)rel->r_offset);
+    if (!rel_dst) {
+        uprintf("  Could not find vma for rel %p offset %p\n",
+                rel, (void *)rel->r_offset);
+        swbkpt();
+        return -1;
+    }
+
+    if (ELF32_R_TYPE(rel->r_info) == R_ARM_FUNCDESC) {
+        // Same as uld_dyn_write_reso_funcdesc, the descriptor allocated
+        // here is the one patched when bound.
+        slot = uld_dyn_dl_alloc(dl_alloc_base, dl_alloc_end, 8,
+                dl_alloc_size);
+        if (!slot) {
+            return -1;
+        }
+        *rel_dst = slot;
+    } else {
+        slot = rel_dst;
+    }
+
+    *slot = (void *)uld_dyn_lazy_stub;
+    *(slot + 1) = import;
+
+    import->slot = slot;
+    import->fse = fse;
+    import->importer = ufile->fse;
+    import->name = name;
+    import->instance = ufile->instance;
+
+    uprintf("  Wrote lazy stub %p for %s::%s to %p\n", import, fse->name,
+            name, slot);
+
+    return 0;
+}
+
+static void uld_dyn_record_resolution(struct uld_file *ufile_list,
+        int file_idx, const struct elf32_rel *rel,
+        const struct uld_dyn_resolution *res,
+        const struct uld_section *dynsym_sec,
+        const struct uld_section *dynstr_sec)
+{
+    struct uld_file *ufile = &ufile_list[file_idx];
+
+    if (!res->ptr) {
+        return;
+    }
+
+    if (res->file_idx != file_idx) {
+        ufile->res_mask |= 1 << res->file_idx;
+    }
+
+    uld_audit(sym_bound, ufile, &ufile_list[res->file_idx],
+            uld_dyn_get_sym_name(uld_dyn_get_dynsym_by_index_sec(
+            ELF32_R_SYM(rel->r_info), dynsym_sec), dynstr_sec),
+            ELF32_R_TYPE(rel->r_info), res->lookups);
+}
+
+int uld_dyn_link_file_list_from(struct uld_file *ufile_list,
+        int first_idx, int file_count, uint8_t *dl_alloc_base,
+        size_t dl_alloc_max, size_t *dl_alloc_size)
 {
     struct uld_dyn_resolution res;
-    const struct uld_file *ufile;
+    struct uld_file *ufile;
     struct uld_section *rel_dyn_sec;
     struct uld_section *dynsym_sec;
     struct uld_section *dynstr_sec;
     const struct elf32_rel *rel;
+    const uint8_t *dl_alloc_end;
     size_t dla_size;
+    uint32_t stamp = 0;
+    int flash_bound;
+    int flash_count;
     int file_idx;
     int ret;
     unsigned int rd_idx;
 
-    if (!ufile_list || file_count <= 0 || !dl_alloc_base || !dl_alloc_size) {
+    if (!ufile_list || first_idx < 0 || file_count <= first_idx ||
+            !dl_alloc_base || !dl_alloc_size) {
         return -1;
     }
 
+    dl_alloc_end = dl_alloc_base + dl_alloc_max;
     dla_size = 0;
+    *dl_alloc_size = 0;
 
-    for (file_idx = 0; file_idx < file_count; file_idx++) {
+    for (file_idx = first_idx; file_idx < file_count; file_idx++) {
         ufile = &ufile_list[file_idx];
+        // Each file's slice is freed on its own, start it on the allocator
+        // granularity so uld_mem_free does not round into the next slice.
+        ufile->dl_alloc_base = ALIGN_PTR(dl_alloc_base, ULD_MEM_ALIGNMENT);
+        if (ufile->dl_alloc_base > dl_alloc_end) {
+            printf("dl_alloc pool overflow\n");
+            swbkpt();
+            return -1;
+        }
+        dla_size += ufile->dl_alloc_base - dl_alloc_base;
+        dl_alloc_base = ufile->dl_alloc_base;
+        ufile->dl_alloc_size = 0;
+        ufile->res_mask = 0;
 
         uld_dyn_get_link_sections(ufile, NULL, &rel_dyn_sec, &dynsym_sec,
                 &dynstr_sec);
@@ -974,7 +1572,24 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
             return -1;
         }
 
+        // Relocations in flash sections are bound again only if a file they
+        // may resolve to changed (see uld_dyn_calc_bind_stamp).
+        flash_bound = -1;
+        flash_count = 0;
+
         uld_dyn_for_each_rel_dyn_sec(rel, rd_idx, rel_dyn_sec) {
+            if (uld_dyn_rel_in_flash(ufile, rel)) {
+                if (flash_bound < 0) {
+                    stamp = uld_dyn_calc_bind_stamp(ufile_list, file_idx,
+                            file_count);
+                    flash_bound = uld_reloc_check_stamp(ufile->fse, stamp);
+                }
+                if (flash_bound) {
+                    continue;
+                }
+                flash_count++;
+            }
+
             switch (ELF32_R_TYPE(rel->r_info)) {
             case R_ARM_ABS32:
                 uprintf("[<%p>] resolving ABS32          %02d:%02d\n",
@@ -982,7 +1597,10 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
                 ret = uld_dyn_resolve_rel(ufile_list, rel, file_idx,
                         rd_idx, &res);
                 if (!ret) {
-                    uld_dyn_write_reso_abs32(ufile_list, file_idx, rel, &res);
+                    uld_dyn_record_resolution(ufile_list, file_idx, rel, &res,
+                            dynsym_sec, dynstr_sec);
+                    ret = uld_dyn_write_reso_abs32(ufile_list, file_idx, rel,
+                            &res);
                 }
                 break;
 
@@ -997,8 +1615,12 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
                         rel, file_idx, rd_idx);
                 ret = uld_dyn_resolve_rel(ufile_list, rel, file_idx,
                         rd_idx, &res);
+                if (!ret) {
+                    uld_dyn_record_resolution(ufile_list, file_idx, rel, &res,
+                            dynsym_sec, dynstr_sec);
+                }
                 ret = uld_dyn_write_reso_glob_dat(ufile_list, file_idx,
-                        rel, &res, &dl_alloc_base, &dla_size);
+                        rel, &res, &dl_alloc_base, dl_alloc_end, &dla_size);
                 break;
 
             case R_ARM_FUNCDESC:
@@ -1007,8 +1629,14 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
                 ret = uld_dyn_resolve_rel(ufile_list, rel, file_idx,
                         rd_idx, &res);
                 if (!ret) {
-                    uld_dyn_write_reso_funcdesc(ufile_list, file_idx,
-                            rel, &res, &dl_alloc_base, &dla_size);
+                    uld_dyn_record_resolution(ufile_list, file_idx, rel, &res,
+                            dynsym_sec, dynstr_sec);
+                    ret = uld_dyn_write_reso_funcdesc(ufile_list, file_idx,
+                            rel, &res, &dl_alloc_base, dl_alloc_end,
+                            &dla_size);
+                } else if (!uld_dyn_rel_in_flash(ufile, rel)) {
+                    ret = uld_dyn_write_lazy_import(ufile, rel,
+                            &dl_alloc_base, dl_alloc_end, &dla_size);
                 }
                 break;
 
@@ -1018,8 +1646,13 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
                 ret = uld_dyn_resolve_rel(ufile_list, rel, file_idx,
                         rd_idx, &res);
                 if (!ret) {
+                    uld_dyn_record_resolution(ufile_list, file_idx, rel, &res,
+                            dynsym_sec, dynstr_sec);
                     uld_dyn_write_reso_funcdesc_value(ufile_list, file_idx,
                             rel, &res);
+                } else {
+                    ret = uld_dyn_write_lazy_import(ufile, rel,
+                            &dl_alloc_base, dl_alloc_end, &dla_size);
                 }
                 break;
 
@@ -1039,97 +1672,2338 @@ int uld_dyn_link_file_list(const struct uld_file *ufile_list, int file_count,
                 return -1;
             }
         }
+
+        ufile->dl_alloc_size = dl_alloc_base - ufile->dl_alloc_base;
+
+        if (flash_count && uld_dyn_finish_flash_bind(ufile, stamp)) {
+            printf("%s: flash relocations not stamped\n", ufile->fse->name);
+            swbkpt();
+            return -1;
+        }
     }
 
+    *dl_alloc_size = dla_size;
     swbkpt_dyn();
 
     return 0;
 }
 
-int uld_dyn_exec_fse(const struct uld_fs_entry *fse, void *sp_base, int argc,
-        const char **argv)
+int uld_dyn_link_file_list(struct uld_file *ufile_list, int file_count,
+        uint8_t *dl_alloc_base, size_t dl_alloc_max, size_t *dl_alloc_size)
+{
+    return uld_dyn_link_file_list_from(ufile_list, 0, file_count,
+            dl_alloc_base, dl_alloc_max, dl_alloc_size);
+}
+
+// Allocate the dl_alloc pool for files [first_idx, file_count) and link them.
+// The pool is the largest free region (in the pinned bank if placed), only
+// the used part is reserved.
+static int uld_dyn_link_alloc_file_list(struct uld_file *ufile_list,
+        int first_idx, int file_count)
 {
-    const struct uld_fs_entry **dep_list;
-    struct uld_file *ufile_list;
-    struct uld_section *sec_list;
-    uint8_t *membase;
     uint8_t *dl_alloc_base;
     size_t dl_alloc_size;
-    size_t allocated;
-    int dep_count;
-    int idx;
+    size_t dl_alloc_max;
     int ret;
-    int sec_count;
+
+    dl_alloc_base = uld_mem_get_largest_in(
+            uld_mem_get_place(ULD_MEM_PLACE_DL_ALLOC), &dl_alloc_max);
+    if (!dl_alloc_base) {
+        printf("no memory for dl_alloc pool\n");
+        return -1;
+    }
+
+    ret = uld_dyn_link_file_list_from(ufile_list, first_idx, file_count,
+            dl_alloc_base, dl_alloc_max, &dl_alloc_size);
+    if (uld_verbose) {
+        printf("uld_dyn_link_file_list: %d\n\n", ret);
+    }
+    if (ret) {
+        return ret;
+    }
+
+    if (dl_alloc_size) {
+        uld_mem_reserve(dl_alloc_base, dl_alloc_size);
+    }
+
+    return 0;
+}
+
+// Reserve the placed stack.  A stack below ESTACK only needs the part
+// outside the loader's stack reserve (see uld_mem_init).
+static int uld_dyn_reserve_stack(const struct uld_dyn_state *ds)
+{
+    size_t size = ds->stack_size;
+
+    if (ds->stack_base + size == ESTACK) {
+        if (size <= ULD_MEM_STACK_SIZE) {
+            return 0;
+        }
+        size -= ULD_MEM_STACK_SIZE;
+    }
+
+    return uld_mem_reserve(ds->stack_base, size);
+}
+
+void uld_dyn_zero_dl_objects(int file_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_file *ufile = &ds->ufile_list[file_idx];
+    const uint8_t *end = ufile->dl_alloc_base + ufile->dl_alloc_size;
+    struct uld_dyn_resolution res;
+    const struct elf32_rel *rel;
+    uint8_t **slot;
+    unsigned int idx;
+
+    if (!ufile->dl_alloc_size || !uld_file_get_sec_rel_dyn(ufile)) {
+        return;
+    }
+
+    uld_dyn_for_each_rel_dyn_file(rel, idx, ufile) {
+        if (ELF32_R_TYPE(rel->r_info) != R_ARM_GLOB_DAT) {
+            continue;
+        }
+
+        // Objects are allocated in the slice of the first file referencing
+        // them, other references resolve to the earlier relocation.
+        slot = (uint8_t **)uld_file_lma_to_adjusted_vma(ufile,
+                (void *)rel->r_offset);
+        if (!slot || *slot < ufile->dl_alloc_base || *slot >= end) {
+            continue;
+        }
+
+        res.match_sym = NULL;
+        if (!uld_dyn_resolve_rel(ds->ufile_list, rel, file_idx, idx, &res) ||
+                !res.match_sym || *slot + res.match_sym->st_size > end) {
+            continue;
+        }
+
+        memset(*slot, 0, res.match_sym->st_size);
+    }
+}
+
+int uld_dyn_reserve_file_list(const struct uld_file *ufile_list,
+        int file_count)
+{
+    const struct uld_dyn_overlay *ov;
+    const struct uld_file *ufile;
+    size_t data_size;
     int i;
 
-    if (uld_verbose >= 2) {
-        DYN_VERBOSE_ENABLE();
-    } else {
-        DYN_VERBOSE_DISABLE();
+    // Overlay windows are reserved whole, members are placed in them.
+    for (i = 0; i < ULD_DYN_OVERLAY_MAX; i++) {
+        ov = &uld_dyn_state.overlay[i];
+        if (ov->base && uld_mem_reserve(ov->base, ov->size)) {
+            uld_mem_init();
+            return -1;
+        }
+    }
+
+    if (uld_dyn_state.stack_size && uld_dyn_reserve_stack(&uld_dyn_state)) {
+        uld_mem_init();
+        return -1;
     }
 
-    dep_count = uld_dyn_get_fse_dep_count(fse);
+    for (i = 0; i < file_count; i++) {
+        ufile = &ufile_list[i];
+        data_size = uld_file_get_data_size(ufile);
+        if ((ufile->memsz && !(ufile->flags & ULD_FILE_FLAG_OVERLAY) &&
+                uld_mem_reserve(ufile->membase, ufile->memsz)) ||
+                (ufile->dl_alloc_size &&
+                uld_mem_reserve(ufile->dl_alloc_base,
+                ufile->dl_alloc_size)) ||
+                (ufile->data_image && data_size &&
+                uld_mem_reserve(ufile->data_image, data_size)) ||
+                (ufile->text_image &&
+                uld_mem_reserve(ufile->text_image, ufile->text_size)) ||
+                (ufile->heap_size &&
+                uld_mem_reserve(ufile->heap_base, ufile->heap_size))) {
+            uld_mem_init();
+            return -1;
+        }
+    }
 
-    dep_list = alloca(sizeof(struct uld_fs_entry *) * dep_count);
-    ufile_list = alloca(sizeof(struct uld_file) * dep_count);
+    return 0;
+}
 
-    idx = 0;
-    ret = uld_dyn_create_fse_dep_list(fse, dep_list, &idx, dep_count);
-    if (uld_verbose) {
-        printf("create_fse_dep_list: %d\n", ret);
+static struct heap *uld_dyn_get_heap(const struct uld_file *ufile)
+{
+    const struct elf32_sym *sym;
+
+    sym = uld_dyn_find_dynsym_elf_hash_file(HEAP_DEFAULT_SYM, ufile);
+    if (!sym || !elf32_sym_has_section_index(sym) ||
+            ELF32_ST_TYPE(sym->st_info) != STT_OBJECT) {
+        return NULL;
     }
 
-    sec_count = uld_dyn_get_dep_list_sec_count(dep_list, dep_count,
-        (ULD_SECTION_FLAG_TYPE_FLASH | ULD_SECTION_FLAG_TYPE_MEM |
-        ULD_SECTION_FLAG_TYPE_DYNAMIC));
+    return (struct heap *)uld_file_lma_to_adjusted_vma(ufile,
+            (void *)sym->st_value);
+}
 
-    sec_list = alloca(sizeof(struct uld_section) * sec_count);
+// Heap size the executable of ufile's program instance declares (see
+// ULD_HEAP_SIZE) or 0.
+static size_t uld_dyn_get_heap_size(const struct uld_file *ufile)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_file *exec;
+    struct uld_section sec;
+    int i;
 
-    if (uld_verbose) {
-        printf("processing %d sections for %d files\n", sec_count, dep_count);
+    for (i = 0; i < ds->file_count; i++) {
+        exec = &ds->ufile_list[i];
+        if (!(exec->flags & ULD_FILE_FLAG_EXEC) ||
+                exec->instance != ufile->instance) {
+            continue;
+        }
+
+        if (uld_file_copy_sec_by_name(exec, &sec, ULD_DYN_HEAP_SEC_NAME,
+                ULD_SECTION_FLAG_TYPE_FLASH) ||
+                sec.shdr->sh_size < sizeof(uint32_t)) {
+            return 0;
+        }
+
+        return ALIGN(*(const uint32_t *)sec.adjusted_lma, ULD_MEM_ALIGNMENT);
     }
 
-    membase = NULL;
-    allocated = 0;
-    ret = uld_dyn_load_fse_dep_list(dep_list, dep_count, ufile_list, sec_list,
-        sec_count, &membase, &allocated);
-    if (uld_verbose) {
-        printf("load_fse_dep_list: %d\n", ret);
+    return 0;
+}
+
+// Split the largest free region, less ULD_DYN_HEAP_KEEP, between loaded
+// files exporting heap_default (one libexc.so per program instance) that do
+// not have an arena yet.  A heap size the executable declares caps its
+// share.  If rewrite is set existing arenas are written to heap_default
+// again as .data/.bss have been reset (warm reset), otherwise they are left
+// alone as the file may still hold blocks (chain).
+static void uld_dyn_seed_heaps(int rewrite)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_file *ufile;
+    struct heap *heap;
+    uint8_t *base = NULL;
+    size_t share = 0;
+    size_t size;
+    int count = 0;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        if (!ds->ufile_list[i].heap_base &&
+                uld_dyn_get_heap(&ds->ufile_list[i])) {
+            count++;
+        }
     }
-    putchar('\n');
 
-    if (uld_verbose) {
-        for (i = 0; i < dep_count; i++) {
-            printf("\nDumping %s tables:\n", ufile_list[i].fse->name);
-            if (uld_verbose >= 2) {
-                uld_print_section_file(&ufile_list[i]);
-                uld_print_dyn(&ufile_list[i], 1);
-                uld_print_dynsym(&ufile_list[i]);
+    if (count) {
+        base = uld_mem_get_largest_in(uld_mem_get_place(ULD_MEM_PLACE_HEAP),
+                &share);
+        share = share > ULD_DYN_HEAP_KEEP ?
+                (share - ULD_DYN_HEAP_KEEP) / count : 0;
+        share &= ~__ALIGN_MASK((size_t)ULD_MEM_ALIGNMENT);
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        heap = uld_dyn_get_heap(ufile);
+        if (!heap) {
+            continue;
+        }
+
+        if (!ufile->heap_base) {
+            size = uld_dyn_get_heap_size(ufile);
+            if (!size || size > share) {
+                size = share;
             }
-            uld_print_rel_dyn(&ufile_list[i]);
+            if (!size || uld_mem_reserve(base, size)) {
+                printf("no memory for %s heap\n", ufile->fse->name);
+                continue;
+            }
+            ufile->heap_base = base;
+            ufile->heap_size = size;
+            base += size;
+            printf("heap: %-16s base: 0x%p size: %d\n", ufile->fse->name,
+                    ufile->heap_base, (int)ufile->heap_size);
+        } else if (!rewrite) {
+            continue;
         }
-        puts("\n");
+
+        heap->base = ufile->heap_base;
+        heap->ptr = ufile->heap_base;
+        heap->end = ufile->heap_base + ufile->heap_size;
+    }
+}
+
+// Place the stack fse declares (see ULD_STACK_SIZE) before modules are
+// loaded so they and the heaps get the rest of RAM.  A reset stack goes in
+// the bank pinned with the stack placement name or else directly below
+// ESTACK, growing the loader's stack reserve if needed.  The reserve is never
+// shrunk, the loader runs on it until entry.  A reused stack can not be
+// moved, only the room left in the reserve is checked.  Returns the stack
+// base to enter fse with.
+static void *uld_dyn_place_stack(const struct uld_fs_entry *fse,
+        void *sp_base)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    size_t size = uld_fs_get_stack_size(fse);
+    size_t room;
+
+    if (!size) {
+        return sp_base;
+    }
+
+    if (!sp_base) {
+        room = cpu_get_sp() - (uint32_t)(ESTACK - ULD_MEM_STACK_SIZE);
+        if (room < size) {
+            printf("stack: %s needs %d bytes, %d left on loader stack\n",
+                    fse->name, (int)size, (int)room);
+        }
+        return sp_base;
+    }
+
+    if (uld_mem_get_place(ULD_MEM_PLACE_STACK) != ULD_MEM_BANK_ANY) {
+        ds->stack_base = uld_mem_alloc_for(ULD_MEM_PLACE_STACK, size);
+        ds->stack_size = ds->stack_base ? size : 0;
+    } else {
+        ds->stack_base = ESTACK - size;
+        ds->stack_size = size;
+        if (uld_dyn_reserve_stack(ds)) {
+            ds->stack_base = NULL;
+            ds->stack_size = 0;
+        }
+    }
+
+    if (!ds->stack_size) {
+        printf("stack: no memory for %s stack of %d bytes\n", fse->name,
+                (int)size);
+        swbkpt();
+        return sp_base;
+    }
+
+    return ds->stack_base + size;
+}
+
+// Stack base for an executable restored with its loaded state.
+static void *uld_dyn_get_stack_top(void *sp_base)
+{
+    const struct uld_dyn_state *ds = &uld_dyn_state;
+
+    if (sp_base && ds->stack_size) {
+        return ds->stack_base + ds->stack_size;
+    }
+
+    return sp_base;
+}
+
+// Run constructors for ufile if they have not been run.  Files marked
+// ULD_FS_ENTRY_FLAG_DEFER_INIT are skipped unless force is set.
+static void uld_dyn_init_file(struct uld_file *ufile, int force)
+{
+    uint32_t cycles;
+
+    if (ufile->flags & ULD_FILE_FLAG_INIT_DONE) {
+        return;
+    }
+
+    if (!force && (ufile->fse->flags & ULD_FS_ENTRY_FLAG_DEFER_INIT)) {
+        if (uld_verbose) {
+            printf("deferring init: %s\n", ufile->fse->name);
+        }
+        return;
+    }
+
+    // Set before calling so a constructor calling through a lazy import
+    // into this file does not run them again.
+    ufile->flags |= ULD_FILE_FLAG_INIT_DONE;
+
+    cycles = cpu_get_cycles();
+    uld_exec_elf_call_init_funcs(ufile);
+    cycles = cpu_get_cycles() - cycles;
+    uld_audit(init_run, ufile, cycles);
+
+    if (uld_verbose && cpu_has_cycles()) {
+        printf("init: %-16s %lu cycles\n", ufile->fse->name,
+                (unsigned long)cycles);
+    }
+}
+
+// Run constructors and enter the executable of a loaded and linked module
+// set (after a cold start or a flat image restore).
+static void uld_dyn_start_exec(void *sp_base, int argc, const char **argv)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        uld_warm_save_data(&ds->ufile_list[i]);
     }
 
-    dl_alloc_base = membase + allocated;
-    ret = uld_dyn_link_file_list(ufile_list, dep_count, dl_alloc_base,
-            &dl_alloc_size);
+    if (ds->stack_size) {
+        printf("stack: %-16s base: 0x%p size: %d\n",
+                ds->ufile_list[ds->exec_idx].fse->name, ds->stack_base,
+                (int)ds->stack_size);
+    }
+    printf("free RAM after layout: %d\n", (int)uld_mem_get_free_size());
+
+    uld_dyn_seed_heaps(0);
+
     if (uld_verbose) {
-        printf("uld_dyn_link_file_list: %d\n\n", ret);
+        uld_print_mem_map();
     }
 
-    uld_print_gdb_sym_cmd_list(ufile_list, idx);
+    uld_print_gdb_sym_cmd_list(ds->ufile_list, ds->file_count);
 
 #ifdef ULD_BREAK_BEFORE_CTOR
     puts("break before ctor - gdb: uc to continue");
     swbkpt();
 #endif
 
-    for (i = 0; i < dep_count; i++) {
-        uld_exec_elf_call_init_funcs(&ufile_list[i]);
+    for (i = 0; i < ds->file_count; i++) {
+        uld_dyn_init_file(&ds->ufile_list[i], 0);
     }
 
-    uld_exec_file(&ufile_list[idx - 1], sp_base, argc, argv);
+#ifdef ULD_SNAPSHOT
+    uld_snap_save();
+#endif
+    uld_warm_update();
 
-    return 0;
+    uld_exec_file(&ds->ufile_list[ds->exec_idx], sp_base, argc, argv);
+}
+
+int uld_dyn_exec_fse(const struct uld_fs_entry *fse, void *sp_base, int argc,
+        const char **argv)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    struct uld_file *ufile_list;
+    struct uld_section *sec_list;
+    int dep_count;
+    int fse_count;
+    int idx;
+    int ret;
+    int sec_count;
+    int i;
+
+    if (uld_verbose >= 2) {
+        DYN_VERBOSE_ENABLE();
+    } else {
+        DYN_VERBOSE_DISABLE();
+    }
+
+#ifdef ULD_SNAPSHOT
+    // Module memory and state are restored with constructors already run.
+    if (!uld_snap_restore(fse)) {
+        // Another executable may have changed the PLT entries in flash.
+        uld_reloc_update_plt(ds->ufile_list, ds->file_count);
+        uld_exec_file(&ds->ufile_list[ds->exec_idx],
+                uld_dyn_get_stack_top(sp_base), argc, argv);
+        return 0;
+    }
+#endif
+
+#ifdef ULD_WARM_RESET
+    // Module .data and .bss are reset so constructors have to run again.
+    if (!uld_warm_restore(fse)) {
+        uld_dyn_seed_heaps(1);
+        for (i = 0; i < ds->file_count; i++) {
+            if (ds->ufile_list[i].flags & ULD_FILE_FLAG_INIT_DONE) {
+                ds->ufile_list[i].flags &= ~ULD_FILE_FLAG_INIT_DONE;
+                uld_dyn_init_file(&ds->ufile_list[i], 1);
+            }
+        }
+        uld_warm_update();
+        uld_exec_file(&ds->ufile_list[ds->exec_idx],
+                uld_dyn_get_stack_top(sp_base), argc, argv);
+        return 0;
+    }
+#endif
+
+    // Loader state and linked module memory are restored, constructors
+    // still have to run.
+    if ((fse->flags & ULD_FS_ENTRY_FLAG_FLAT) && !uld_flat_restore(fse)) {
+        uld_dyn_start_exec(uld_dyn_get_stack_top(sp_base), argc, argv);
+        return 0;
+    }
+
+    // Preload modules are added first, use the number of files as the
+    // bound.
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    // Loaded file and section state must outlive this function for runtime
+    // services (the stack may be reset before entry).
+    ufile_list = ds->ufile_list;
+    sec_list = ds->sec_list;
+
+    memset(ds, 0, sizeof(struct uld_dyn_state));
+    ds->program_count = 1;
+
+    idx = 0;
+    ret = uld_dyn_create_preload_dep_list(dep_list, &idx, fse_count,
+            ds->lazy_fse, &ds->lazy_count);
+    if (!ret) {
+        ret = uld_dyn_create_fse_dep_list_lazy(fse, dep_list, &idx,
+                fse_count, ds->lazy_fse, &ds->lazy_count);
+    }
+    if (uld_verbose) {
+        printf("create_fse_dep_list: %d\n", ret);
+        for (i = 0; i < ds->lazy_count; i++) {
+            printf("lazy: %s\n", ds->lazy_fse[i]->name);
+        }
+    }
+
+    // Lazy libraries and dependencies only they require are not loaded.
+    dep_count = idx;
+    if (ret || dep_count > ULD_DYN_FILE_MAX) {
+        printf("invalid dependency count %d (max %d)\n", dep_count,
+                ULD_DYN_FILE_MAX);
+        swbkpt();
+        return -1;
+    }
+
+    sec_count = uld_dyn_get_dep_list_sec_count(dep_list, dep_count,
+        (ULD_SECTION_FLAG_TYPE_FLASH | ULD_SECTION_FLAG_TYPE_MEM |
+        ULD_SECTION_FLAG_TYPE_DYNAMIC));
+    if (sec_count > ULD_DYN_SECTION_MAX) {
+        printf("section count %d exceeds max %d\n", sec_count,
+                ULD_DYN_SECTION_MAX);
+        swbkpt();
+        return -1;
+    }
+
+    if (uld_verbose) {
+        printf("processing %d sections for %d files\n", sec_count, dep_count);
+    }
+
+    sp_base = uld_dyn_place_stack(fse, sp_base);
+
+    ret = uld_dyn_load_fse_dep_list(dep_list, dep_count, ufile_list, sec_list,
+        sec_count);
+    if (uld_verbose) {
+        printf("load_fse_dep_list: %d\n", ret);
+    }
+    putchar('\n');
+    if (ret) {
+        return -1;
+    }
+
+    if (uld_verbose) {
+        for (i = 0; i < dep_count; i++) {
+            printf("\nDumping %s tables:\n", ufile_list[i].fse->name);
+            if (uld_verbose >= 2) {
+                uld_print_section_file(&ufile_list[i]);
+                uld_print_dyn(&ufile_list[i], 1);
+                uld_print_dynsym(&ufile_list[i]);
+            }
+            uld_print_rel_dyn(&ufile_list[i]);
+        }
+        puts("\n");
+    }
+
+    uld_dyn_mark_preload(ufile_list, dep_count);
+    // Rebuilt when the flash address or membase of a file changed, before
+    // linking so importers use them.
+    uld_reloc_update_fdtab(ufile_list, dep_count);
+    ret = uld_dyn_link_alloc_file_list(ufile_list, 0, dep_count);
+    if (ret) {
+        return -1;
+    }
+    uld_reloc_update_plt(ufile_list, dep_count);
+
+    // Files loaded at boot are referenced for the life of the executable.
+    for (i = 0; i < dep_count; i++) {
+        ufile_list[i].refcount = 1;
+        ufile_list[i].flags |= ULD_FILE_FLAG_BOOT;
+    }
+    ds->file_count = dep_count;
+    ds->sec_count = sec_count;
+    ds->exec_idx = idx - 1;
+
+    // Saved before memory is allocated for the warm reset .data images and
+    // heaps, they are set up again after a restore.
+    if (fse->flags & ULD_FS_ENTRY_FLAG_FLAT) {
+        uld_flat_save();
+    }
+
+    uld_dyn_start_exec(sp_base, argc, argv);
+
+    return 0;
+}
+
+// Only files of the current program instance are searched.
+static int uld_dyn_find_loaded_fse(const struct uld_fs_entry *fse)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        if (ds->ufile_list[i].fse == fse &&
+                ds->ufile_list[i].instance == ds->instance) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Dependency closure of fse in load order.  Returns count or < 0 on error.
+static int uld_dyn_get_closure(const struct uld_fs_entry *fse,
+        const struct uld_fs_entry **dep_list, int list_size)
+{
+    int idx = 0;
+    int ret;
+
+    ret = uld_dyn_create_fse_dep_list(fse, dep_list, &idx, list_size);
+    if (ret) {
+        return ret;
+    }
+
+    return idx;
+}
+
+static void uld_dyn_release_dlsym_funcdesc(const struct uld_file *ufile)
+{
+    struct uld_dyn_funcdesc *fd;
+    const uint8_t *base;
+    int i;
+
+    for (i = 0; i < ULD_DYN_DLSYM_FUNCDESC_MAX; i++) {
+        fd = &uld_dyn_state.dlsym_fd[i];
+        if (!fd->fp) {
+            continue;
+        }
+        base = ufile->fse->base;
+        if ((ufile->membase && fd->fb == ufile->membase) ||
+                ((const uint8_t *)fd->fp >= base &&
+                (const uint8_t *)fd->fp < base + ufile->fse->size)) {
+            fd->fp = NULL;
+            fd->fb = NULL;
+        }
+    }
+}
+
+static void uld_dyn_release_lazy_import(const struct uld_file *ufile)
+{
+    struct uld_dyn_lazy_import *import;
+    int i;
+
+    for (i = 0; i < ULD_DYN_LAZY_IMPORT_MAX; i++) {
+        import = &uld_dyn_state.lazy_import[i];
+        if (import->fse && import->importer == ufile->fse &&
+                import->instance == ufile->instance) {
+            import->fse = NULL;
+        }
+    }
+}
+
+// Reset imports from an overlay member being evicted to uld_dyn_lazy_stub.
+// The window is kept for the next member.
+static void uld_dyn_overlay_unbind(const struct uld_file *ufile)
+{
+    struct uld_dyn_lazy_import *import;
+    int i;
+
+    for (i = 0; i < ULD_DYN_LAZY_IMPORT_MAX; i++) {
+        import = &uld_dyn_state.lazy_import[i];
+        if (import->fse == ufile->fse &&
+                import->instance == ufile->instance) {
+            *import->slot = (void *)uld_dyn_lazy_stub;
+            *(import->slot + 1) = import;
+        }
+    }
+
+    uld_dyn_state.overlay[uld_fs_get_overlay(ufile->fse) - 1].active = NULL;
+}
+
+static int uld_dyn_is_referenced(int file_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    int i;
+
+    // Files bound lazily may be loaded before the file they resolved
+    // against.
+    for (i = 0; i < ds->file_count; i++) {
+        if (i != file_idx && (ds->ufile_list[i].res_mask & (1 << file_idx))) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Remove file_idx from ufile_list/sec_list and renumber resolution records.
+static void uld_dyn_remove_file(int file_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_file *ufile;
+    struct uld_section *sec_start;
+    uint32_t low_mask;
+    int sec_num;
+    int sec_after;
+    int i;
+    int j;
+
+    ufile = &ds->ufile_list[file_idx];
+    sec_num = uld_file_get_sec_count(ufile);
+
+    // Sections for each file are contiguous and in file order, find the
+    // first section of the file being removed.
+    sec_start = ds->sec_list;
+    for (i = 0; i < file_idx; i++) {
+        sec_start += uld_file_get_sec_count(&ds->ufile_list[i]);
+    }
+    sec_after = &ds->sec_list[ds->sec_count] - (sec_start + sec_num);
+
+    memmove(sec_start, sec_start + sec_num,
+            sizeof(struct uld_section) * sec_after);
+    memmove(ufile, ufile + 1,
+            sizeof(struct uld_file) * (ds->file_count - file_idx - 1));
+    ds->file_count--;
+    ds->sec_count -= sec_num;
+    if (ds->exec_idx > file_idx) {
+        ds->exec_idx--;
+    }
+
+    low_mask = (1 << file_idx) - 1;
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        ufile->res_mask = (ufile->res_mask & low_mask) |
+                ((ufile->res_mask >> 1) & ~low_mask);
+
+        if (i < file_idx) {
+            continue;
+        }
+        for (j = 0; j < ULD_FILE_SECTION_TYPE_COUNT; j++) {
+            if (ufile->sec.s[j]) {
+                ufile->sec.s[j] -= sec_num;
+            }
+        }
+    }
+}
+
+static void uld_dyn_unload_file(int file_idx)
+{
+    struct uld_file *ufile = &uld_dyn_state.ufile_list[file_idx];
+
+    if (ufile->flags & ULD_FILE_FLAG_INIT_DONE) {
+        uld_exec_elf_call_fini_funcs(ufile);
+    }
+    uld_irq_release(ufile);
+    uld_dyn_release_dlsym_funcdesc(ufile);
+    uld_dyn_release_lazy_import(ufile);
+
+    printf("unloaded: %-16s mem base: 0x%p mem size: %d dl_alloc: %d\n",
+            ufile->fse->name, ufile->membase, ufile->memsz,
+            ufile->dl_alloc_size);
+
+    if (ufile->flags & ULD_FILE_FLAG_OVERLAY) {
+        uld_dyn_overlay_unbind(ufile);
+    } else if (ufile->membase) {
+        uld_mem_free(ufile->membase, ufile->memsz);
+    }
+    if (ufile->dl_alloc_size) {
+        uld_mem_free(ufile->dl_alloc_base, ufile->dl_alloc_size);
+    }
+    if (ufile->heap_size) {
+        uld_mem_free(ufile->heap_base, ufile->heap_size);
+    }
+    uld_load_free_text(ufile);
+    uld_warm_free_data(ufile);
+
+    uld_dyn_remove_file(file_idx);
+}
+
+// Unload files without references, importers are usually checked first so
+// the providers they depend on can be released in the same pass.
+static void uld_dyn_release_unused(void)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    int released;
+    int i;
+
+    // Lazily bound libraries are loaded after their importers so repeat
+    // until no file is released.
+    do {
+        released = 0;
+        for (i = ds->file_count - 1; i >= 0; i--) {
+            if (ds->ufile_list[i].refcount ||
+                    (ds->ufile_list[i].flags & ULD_FILE_FLAG_BOOT) ||
+                    uld_dyn_is_referenced(i)) {
+                continue;
+            }
+            uld_dyn_unload_file(i);
+            released = 1;
+        }
+    } while (released);
+
+    if (uld_verbose) {
+        uld_print_mem();
+    }
+}
+
+// Unload the active member of overlay group (any program instance).
+static void uld_dyn_overlay_evict(unsigned int group)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry *active = ds->overlay[group - 1].active;
+    int i;
+
+    if (!active) {
+        return;
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        if (ds->ufile_list[i].fse == active) {
+            printf("overlay %u: evict %s\n", group, active->name);
+            uld_dyn_unload_file(i);
+            uld_dyn_release_unused();
+            return;
+        }
+    }
+}
+
+// Load, link and initialize the files in dep_list that are not loaded.
+static int uld_dyn_load_dep_list(const struct uld_fs_entry **dep_list,
+        int dep_count)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **new_list;
+    int new_count;
+    int sec_count;
+    int first_idx;
+    int ret;
+    int i;
+    int j;
+
+    // Overlay group members share one membase, a closure that needs two of
+    // them can not be loaded.
+    for (i = 0; i < dep_count; i++) {
+        if (!uld_fs_get_overlay(dep_list[i])) {
+            continue;
+        }
+        for (j = i + 1; j < dep_count; j++) {
+            if (uld_fs_get_overlay(dep_list[j]) ==
+                    uld_fs_get_overlay(dep_list[i])) {
+                printf("%s, %s: same overlay group %u\n", dep_list[i]->name,
+                        dep_list[j]->name, uld_fs_get_overlay(dep_list[i]));
+                return -1;
+            }
+        }
+    }
+
+    // Only one member of an overlay group is loaded at a time.  Evict
+    // before finding which files are loaded, dependencies only the evicted
+    // member needed are released.
+    for (i = 0; i < dep_count; i++) {
+        if (uld_fs_get_overlay(dep_list[i]) &&
+                uld_dyn_find_loaded_fse(dep_list[i]) < 0) {
+            uld_dyn_overlay_evict(uld_fs_get_overlay(dep_list[i]));
+        }
+    }
+
+    // dep_list is in load order so files not yet loaded can be loaded in the
+    // same order.
+    new_list = alloca(sizeof(struct uld_fs_entry *) * dep_count);
+    new_count = 0;
+    for (i = 0; i < dep_count; i++) {
+        if (uld_dyn_find_loaded_fse(dep_list[i]) < 0) {
+            new_list[new_count++] = dep_list[i];
+        }
+    }
+
+    if (!new_count) {
+        return 0;
+    }
+
+    if (ds->file_count + new_count > ULD_DYN_FILE_MAX) {
+        printf("no room for %d files\n", new_count);
+        return -1;
+    }
+
+    sec_count = uld_dyn_get_dep_list_sec_count(new_list, new_count,
+            ULD_DYN_LOAD_SECTION_TYPE_MASK);
+    if (ds->sec_count + sec_count > ULD_DYN_SECTION_MAX) {
+        printf("no room for %d sections\n", sec_count);
+        return -1;
+    }
+
+    // Entries past file_count/sec_count are unused so state is not
+    // updated until linking succeeds.
+    first_idx = ds->file_count;
+    ret = uld_dyn_load_fse_dep_list(new_list, new_count,
+            &ds->ufile_list[first_idx], &ds->sec_list[ds->sec_count],
+            sec_count);
+    if (ret) {
+        return -1;
+    }
+
+    for (i = first_idx; i < first_idx + new_count; i++) {
+        ds->ufile_list[i].instance = ds->instance;
+    }
+
+    ret = uld_dyn_link_alloc_file_list(ds->ufile_list, first_idx,
+            first_idx + new_count);
+    if (ret) {
+        for (i = first_idx; i < first_idx + new_count; i++) {
+            if (ds->ufile_list[i].flags & ULD_FILE_FLAG_OVERLAY) {
+                ds->overlay[uld_fs_get_overlay(new_list[i - first_idx]) -
+                        1].active = NULL;
+            } else {
+                uld_mem_free(ds->ufile_list[i].membase,
+                        ds->ufile_list[i].memsz);
+            }
+            uld_load_free_text(&ds->ufile_list[i]);
+        }
+        return -1;
+    }
+
+    ds->file_count += new_count;
+    ds->sec_count += sec_count;
+    uld_reloc_update_plt(ds->ufile_list, ds->file_count);
+
+    for (i = first_idx; i < ds->file_count; i++) {
+        uld_warm_save_data(&ds->ufile_list[i]);
+    }
+
+    if (uld_verbose) {
+        uld_print_mem();
+        uld_print_gdb_sym_cmd_list(&ds->ufile_list[first_idx], new_count);
+    }
+
+    for (i = first_idx; i < ds->file_count; i++) {
+        uld_dyn_init_file(&ds->ufile_list[i], 0);
+    }
+
+    return 0;
+}
+
+// Run constructors, including deferred, for fse and its loaded dependencies
+// in load order.
+static int uld_dyn_init_closure(const struct uld_fs_entry *fse)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    int fse_count;
+    int dep_count;
+    int idx;
+    int i;
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    dep_count = uld_dyn_get_closure(fse, dep_list, fse_count);
+    if (dep_count <= 0) {
+        return -1;
+    }
+
+    for (i = 0; i < dep_count; i++) {
+        // Lazy libraries in the closure may not be loaded yet.
+        idx = uld_dyn_find_loaded_fse(dep_list[i]);
+        if (idx >= 0) {
+            uld_dyn_init_file(&ds->ufile_list[idx], 1);
+        }
+    }
+
+    return 0;
+}
+
+int uld_dyn_module_init(const char *name)
+{
+    const struct uld_fs_entry *fse;
+    int ret;
+
+    if (!name) {
+        return -1;
+    }
+
+    fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), name);
+    if (!fse || uld_dyn_find_loaded_fse(fse) < 0) {
+        printf("module init: %s not loaded\n", name);
+        return -1;
+    }
+
+    ret = uld_dyn_init_closure(fse);
+    uld_warm_update();
+
+    return ret;
+}
+
+void *uld_dyn_dlopen(const char *name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry *fse;
+    const struct uld_fs_entry **dep_list;
+    int fse_count;
+    int dep_count;
+    int first_idx;
+    int i;
+
+    // Runtime services require a set loaded by uld_dyn_exec_fse.
+    if (!name || !ds->file_count) {
+        return NULL;
+    }
+
+    fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), name);
+    if (!fse) {
+        printf("dlopen: could not find %s\n", name);
+        return NULL;
+    }
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+
+    dep_count = uld_dyn_get_closure(fse, dep_list, fse_count);
+    if (dep_count <= 0) {
+        printf("dlopen: could not create dep list for %s\n", name);
+        return NULL;
+    }
+
+    first_idx = ds->file_count;
+    if (uld_dyn_load_dep_list(dep_list, dep_count)) {
+        printf("dlopen: could not load %s\n", name);
+        return NULL;
+    }
+
+    for (i = first_idx; i < ds->file_count; i++) {
+        ds->ufile_list[i].flags |= ULD_FILE_FLAG_DLOPEN;
+    }
+
+    // An explicit dlopen is a first use, run deferred constructors.
+    uld_dyn_init_closure(fse);
+
+    // Reference the entire closure so dependencies already loaded by another
+    // dlopen call are not released before this file.
+    for (i = 0; i < dep_count; i++) {
+        ds->ufile_list[uld_dyn_find_loaded_fse(dep_list[i])].refcount++;
+    }
+    ds->ufile_list[uld_dyn_find_loaded_fse(fse)].dlopen_count++;
+    uld_warm_update();
+
+    return (void *)fse;
+}
+
+// Load fse into the current program instance if needed and bind every
+// import from it.  Imports from overlay members are kept so they can be
+// reset when the member is evicted.
+static int uld_dyn_bind_lazy_fse(const struct uld_fs_entry *fse)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_dyn_lazy_import *pos;
+    const struct uld_fs_entry **dep_list;
+    const struct elf32_sym *sym;
+    const struct uld_file *ufile;
+    int fse_count;
+    int dep_count;
+    int file_idx;
+    int importer_idx;
+    int i;
+
+    file_idx = uld_dyn_find_loaded_fse(fse);
+    if (file_idx < 0) {
+        fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+        dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+        dep_count = uld_dyn_get_closure(fse, dep_list, fse_count);
+        if (dep_count <= 0 || uld_dyn_load_dep_list(dep_list, dep_count)) {
+            printf("lazy bind: could not load %s\n", fse->name);
+            swbkpt();
+            return -1;
+        }
+        file_idx = uld_dyn_find_loaded_fse(fse);
+    }
+
+    // Bind every import from this file, the library is kept loaded by the
+    // resolution records of its importers.
+    ufile = &ds->ufile_list[file_idx];
+    for (i = 0; i < ULD_DYN_LAZY_IMPORT_MAX; i++) {
+        pos = &ds->lazy_import[i];
+        if (pos->fse != fse || pos->instance != ds->instance) {
+            continue;
+        }
+
+        sym = uld_dyn_find_dynsym_elf_hash_file(pos->name, ufile);
+        if (!sym) {
+            printf("lazy bind: %s not found in %s\n", pos->name, fse->name);
+            swbkpt();
+            return -1;
+        }
+
+        *pos->slot = (void *)uld_file_lma_to_adjusted_vma(ufile,
+                (void *)sym->st_value);
+        *(pos->slot + 1) = ufile->membase;
+        uprintf("  Wrote FUNCDESC_VALUE %p - %p to %p\n", *pos->slot,
+                *(pos->slot + 1), pos->slot);
+
+        importer_idx = uld_dyn_find_loaded_fse(pos->importer);
+        if (importer_idx >= 0) {
+            ds->ufile_list[importer_idx].res_mask |= 1 << file_idx;
+        }
+
+        if (!(ufile->flags & ULD_FILE_FLAG_OVERLAY)) {
+            pos->fse = NULL;
+        }
+    }
+
+    // First import resolution is a first use, run deferred constructors.
+    uld_dyn_init_closure(fse);
+    uld_warm_update();
+
+    return 0;
+}
+
+const void *uld_dyn_lazy_bind(struct uld_dyn_lazy_import *import)
+{
+    const void *fd;
+    int ret;
+
+    fd = import->slot;
+    printf("lazy bind: %s::%s\n", import->fse->name, import->name);
+
+    // Called in thread mode from the running program, other programs must
+    // not enter uld until binding is done.
+    uld_sched_lock();
+
+    // The library is loaded into the importer's program instance.
+    uld_dyn_state.instance = import->instance;
+    ret = uld_dyn_bind_lazy_fse(import->fse);
+    uld_sched_unlock();
+
+    return ret ? NULL : fd;
+}
+
+static const void *uld_dyn_dlsym_funcdesc(const void *fp, const void *fb)
+{
+    struct uld_dyn_funcdesc *fd;
+    struct uld_dyn_funcdesc *empty = NULL;
+    int i;
+
+    for (i = 0; i < ULD_DYN_DLSYM_FUNCDESC_MAX; i++) {
+        fd = &uld_dyn_state.dlsym_fd[i];
+        if (fd->fp == fp && fd->fb == fb) {
+            return fd;
+        }
+        if (!fd->fp && !empty) {
+            empty = fd;
+        }
+    }
+
+    if (!empty) {
+        return NULL;
+    }
+
+    empty->fp = fp;
+    empty->fb = fb;
+    uld_warm_update();
+
+    return empty;
+}
+
+// Number of unused uld_dyn_dlsym descriptors.
+static int uld_dyn_dlsym_funcdesc_free(void)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < ULD_DYN_DLSYM_FUNCDESC_MAX; i++) {
+        if (!uld_dyn_state.dlsym_fd[i].fp) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void *uld_dyn_dlsym_file(const struct uld_file *ufile,
+        const char *name)
+{
+    const struct elf32_sym *sym;
+    const void *addr;
+
+    sym = uld_dyn_find_dynsym_elf_hash_file(name, ufile);
+    if (!sym || !elf32_sym_has_section_index(sym)) {
+        return NULL;
+    }
+
+    addr = uld_file_lma_to_adjusted_vma(ufile, (void *)sym->st_value);
+    if (!addr) {
+        return NULL;
+    }
+
+    // Function pointers in FDPIC are pointers to a function descriptor.
+    if (ELF32_ST_TYPE(sym->st_info) == STT_FUNC) {
+        return (void *)uld_dyn_dlsym_funcdesc(addr, ufile->membase);
+    }
+
+    return (void *)addr;
+}
+
+void *uld_dyn_dlsym(void *handle, const char *name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    void *ptr;
+    int fse_count;
+    int dep_count;
+    int idx;
+    int i;
+
+    if (!name) {
+        return NULL;
+    }
+
+    if (!handle) {
+        for (i = ds->file_count - 1; i >= 0; i--) {
+            if (ds->ufile_list[i].instance != ds->instance) {
+                continue;
+            }
+            ptr = uld_dyn_dlsym_file(&ds->ufile_list[i], name);
+            if (ptr) {
+                return ptr;
+            }
+        }
+        return NULL;
+    }
+
+    if (uld_dyn_find_loaded_fse(handle) < 0) {
+        return NULL;
+    }
+
+    // Search the file first then its dependencies in reverse load order
+    // (same order as uld_dyn_resolve_rel).
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    dep_count = uld_dyn_get_closure(handle, dep_list, fse_count);
+
+    for (i = dep_count - 1; i >= 0; i--) {
+        idx = uld_dyn_find_loaded_fse(dep_list[i]);
+        if (idx < 0) {
+            continue;
+        }
+        ptr = uld_dyn_dlsym_file(&ds->ufile_list[idx], name);
+        if (ptr) {
+            return ptr;
+        }
+    }
+
+    return NULL;
+}
+
+int uld_dyn_dlclose(void *handle)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    int fse_count;
+    int dep_count;
+    int idx;
+    int i;
+
+    // Only handles returned by uld_dyn_dlopen hold references.
+    idx = uld_dyn_find_loaded_fse(handle);
+    if (idx < 0 || !ds->ufile_list[idx].dlopen_count) {
+        return -1;
+    }
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    dep_count = uld_dyn_get_closure(handle, dep_list, fse_count);
+    if (dep_count <= 0) {
+        return -1;
+    }
+
+    ds->ufile_list[idx].dlopen_count--;
+    for (i = 0; i < dep_count; i++) {
+        idx = uld_dyn_find_loaded_fse(dep_list[i]);
+        if (idx >= 0 && ds->ufile_list[idx].refcount) {
+            ds->ufile_list[idx].refcount--;
+        }
+    }
+
+    uld_dyn_release_unused();
+    uld_warm_update();
+
+    return 0;
+}
+
+int uld_dyn_chain_fse(const struct uld_fs_entry *fse, int argc,
+        const char **argv)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    int fse_count;
+    int idx;
+    int ret;
+    int i;
+
+    if (!fse || !ds->file_count || ds->program_count != 1) {
+        return -1;
+    }
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+
+    // Lazy dependencies are added to the lazy list and bound on first call
+    // as they are at boot.
+    idx = 0;
+    ret = uld_dyn_create_fse_dep_list_lazy(fse, dep_list, &idx, fse_count,
+            ds->lazy_fse, &ds->lazy_count);
+    if (ret) {
+        printf("chain: could not create dep list for %s: %d\n", fse->name,
+                ret);
+        return -1;
+    }
+
+    // Drop references held by the previous executable and its dlopen calls
+    // then reference what fse needs.  The previous executable is unloaded
+    // first followed by libraries only it used.
+    for (i = 0; i < ds->file_count; i++) {
+        ds->ufile_list[i].refcount = 0;
+        ds->ufile_list[i].dlopen_count = 0;
+        ds->ufile_list[i].flags &=
+                ~(ULD_FILE_FLAG_DLOPEN | ULD_FILE_FLAG_BOOT);
+    }
+    for (i = 0; i < idx; i++) {
+        ret = uld_dyn_find_loaded_fse(dep_list[i]);
+        if (ret >= 0 && !(ds->ufile_list[ret].flags & ULD_FILE_FLAG_EXEC)) {
+            ds->ufile_list[ret].refcount = 1;
+            ds->ufile_list[ret].flags |= ULD_FILE_FLAG_BOOT;
+        }
+    }
+    uld_dyn_release_unused();
+
+    if (uld_verbose) {
+        for (i = 0; i < ds->file_count; i++) {
+            printf("chain: keeping %s\n", ds->ufile_list[i].fse->name);
+        }
+    }
+
+    if (uld_dyn_load_dep_list(dep_list, idx)) {
+        printf("chain: could not load %s\n", fse->name);
+        swbkpt();
+        return -1;
+    }
+
+    for (i = 0; i < idx; i++) {
+        ret = uld_dyn_find_loaded_fse(dep_list[i]);
+        ds->ufile_list[ret].refcount = 1;
+        ds->ufile_list[ret].flags |= ULD_FILE_FLAG_BOOT;
+    }
+    ds->exec_idx = uld_dyn_find_loaded_fse(fse);
+
+    uld_dyn_seed_heaps(0);
+
+    if (uld_verbose) {
+        uld_print_mem_map();
+    }
+
+    uld_warm_update();
+
+    uld_exec_file(&ds->ufile_list[ds->exec_idx], NULL, argc, argv);
+
+    return 0;
+}
+
+int uld_dyn_exec_fse_list(const struct uld_fs_entry **fse_list, int count,
+        int argc, const char **argv)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry **dep_list;
+    const struct uld_file *ufile;
+    uint8_t *stack_list[ULD_DYN_PROGRAM_MAX];
+    size_t stack_size[ULD_DYN_PROGRAM_MAX];
+    int fse_count;
+    int idx;
+    int ret;
+    int i;
+    int j;
+
+    if (!fse_list || count <= 0 || count > ULD_DYN_PROGRAM_MAX) {
+        return -1;
+    }
+
+    if (uld_verbose >= 2) {
+        DYN_VERBOSE_ENABLE();
+    } else {
+        DYN_VERBOSE_DISABLE();
+    }
+
+    memset(ds, 0, sizeof(struct uld_dyn_state));
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+
+    // Each program's closure is loaded and linked as a new instance after
+    // the previous programs.  uld_dyn_find_loaded_fse only matches the
+    // current instance so shared libraries are loaded again.
+    for (i = 0; i < count; i++) {
+        ds->instance = i;
+        idx = 0;
+        ret = uld_dyn_create_fse_dep_list_lazy(fse_list[i], dep_list, &idx,
+                fse_count, ds->lazy_fse, &ds->lazy_count);
+        if (ret || uld_dyn_load_dep_list(dep_list, idx)) {
+            printf("could not load program %d: %s\n", i, fse_list[i]->name);
+            swbkpt();
+            return -1;
+        }
+
+        for (j = 0; j < idx; j++) {
+            ret = uld_dyn_find_loaded_fse(dep_list[j]);
+            ds->ufile_list[ret].refcount = 1;
+            ds->ufile_list[ret].flags |= ULD_FILE_FLAG_BOOT;
+        }
+        ds->program_count++;
+
+        // Stack follows the program's memory in the free list.  The size
+        // the executable declares (see ULD_STACK_SIZE) is used if set.
+        stack_size[i] = uld_fs_get_stack_size(fse_list[i]);
+        if (!stack_size[i]) {
+            stack_size[i] = ULD_SCHED_STACK_SIZE;
+        }
+        stack_list[i] = uld_mem_alloc(stack_size[i]);
+        if (!stack_list[i]) {
+            printf("no memory for program %d stack\n", i);
+            swbkpt();
+            return -1;
+        }
+
+        if (uld_verbose) {
+            printf("program %d: %s\n", i, fse_list[i]->name);
+        }
+    }
+
+    uld_dyn_seed_heaps(0);
+
+    if (uld_verbose) {
+        uld_print_mem_map();
+    }
+
+    uld_warm_update();
+
+    for (i = 0; i < count; i++) {
+        ds->instance = i;
+        ds->exec_idx = uld_dyn_find_loaded_fse(fse_list[i]);
+        ufile = &ds->ufile_list[ds->exec_idx];
+        if (uld_sched_add_task(uld_file_get_adjusted_entry(ufile),
+                (uint32_t)ufile->membase, i, stack_list[i],
+                stack_size[i], argc, argv) < 0) {
+            swbkpt();
+            return -1;
+        }
+    }
+
+    printf("\nstarting %d programs\n\n", count);
+    uld_sched_run();
+
+    for (i = 0; i < count; i++) {
+        uld_mem_free(stack_list[i], stack_size[i]);
+    }
+
+    return 0;
+}
+
+static int uld_dyn_swap_in_file(const struct uld_file *ufile, const void *addr)
+{
+    const uint8_t *p = addr;
+    const uint8_t *base = ufile->fse->base;
+
+    return (p >= ufile->membase && p < ufile->membase + ufile->memsz) ||
+            (p >= ufile->dl_alloc_base &&
+            p < ufile->dl_alloc_base + ufile->dl_alloc_size) ||
+            (p >= base && p < base + ufile->fse->size);
+}
+
+// Canonical descriptors in the fdtab area are only written with
+// cpu_flash_write and persist, slots using them are repointed instead.
+static int uld_dyn_in_fdtab(const void *addr)
+{
+    const uint8_t *p = addr;
+
+    return p >= ULD_RELOC_FDTAB_BASE &&
+            p < ULD_RELOC_FDTAB_BASE + ULD_RELOC_FDTAB_SIZE;
+}
+
+// Translate addr, an address in old_ufile for sym name, to new_ufile.
+// Returns NULL if new_ufile does not define name.
+static const void *uld_dyn_swap_translate(const struct uld_file *old_ufile,
+        const struct uld_file *new_ufile, const char *name, const void *addr)
+{
+    const struct elf32_sym *old_sym;
+    const struct elf32_sym *new_sym;
+    const uint8_t *old_addr;
+    const uint8_t *new_addr;
+
+    old_sym = uld_dyn_find_dynsym_elf_hash_file(name, old_ufile);
+    new_sym = uld_dyn_find_dynsym_elf_hash_file(name, new_ufile);
+    if (!old_sym || !new_sym || !elf32_sym_has_section_index(new_sym)) {
+        return NULL;
+    }
+
+    old_addr = uld_file_lma_to_adjusted_vma(old_ufile,
+            (void *)old_sym->st_value);
+    new_addr = uld_file_lma_to_adjusted_vma(new_ufile,
+            (void *)new_sym->st_value);
+    if (!old_addr || !new_addr) {
+        return NULL;
+    }
+
+    // Keep any addend into the object.
+    return new_addr + ((const uint8_t *)addr - old_addr);
+}
+
+// Repoint GOT entries of importer that resolved into old_ufile.  Nothing is
+// written unless write is set so all entries can be checked first.
+// fd_count is incremented for each uld_dyn_dlsym descriptor used.
+static int uld_dyn_swap_importer(const struct uld_file *importer,
+        const struct uld_file *old_ufile, const struct uld_file *new_ufile,
+        int write, int *fd_count)
+{
+    struct uld_section *dynsym_sec;
+    struct uld_section *dynstr_sec;
+    const struct elf32_rel *rel;
+    const struct elf32_sym *sym;
+    const char *name;
+    const void *addr;
+    void **slot;
+    void **fd;
+    unsigned int idx;
+
+    if (!uld_file_get_sec_rel_dyn(importer)) {
+        return 0;
+    }
+
+    uld_dyn_get_link_sections(importer, NULL, NULL, &dynsym_sec,
+            &dynstr_sec);
+
+    uld_dyn_for_each_rel_dyn_file(rel, idx, importer) {
+        sym = uld_dyn_get_dynsym_by_index_sec(ELF32_R_SYM(rel->r_info),
+                dynsym_sec);
+        name = uld_dyn_get_sym_name(sym, dynstr_sec);
+        slot = (void **)uld_file_lma_to_adjusted_vma(importer,
+                (void *)rel->r_offset);
+        if (!slot) {
+            continue;
+        }
+        // Pointer tables in flash sections are not rewritten in place.
+        if (uld_dyn_rel_in_flash(importer, rel)) {
+            if (uld_dyn_swap_in_file(old_ufile, *slot) ||
+                    (uld_dyn_in_fdtab(*slot) &&
+                    *((void **)*slot + 1) == old_ufile->membase)) {
+                printf("swap: %s imports %s from flash\n",
+                        importer->fse->name, name);
+                return -1;
+            }
+            continue;
+        }
+
+        switch (ELF32_R_TYPE(rel->r_info)) {
+        case R_ARM_ABS32:
+        case R_ARM_GLOB_DAT:
+            if (!uld_dyn_swap_in_file(old_ufile, *slot)) {
+                continue;
+            }
+            addr = uld_dyn_swap_translate(old_ufile, new_ufile, name, *slot);
+            if (!addr) {
+                break;
+            }
+            if (write) {
+                *slot = (void *)addr;
+            }
+            continue;
+
+        case R_ARM_FUNCDESC_VALUE:
+            if (*(slot + 1) != old_ufile->membase) {
+                continue;
+            }
+            addr = uld_dyn_swap_translate(old_ufile, new_ufile, name, *slot);
+            if (!addr) {
+                break;
+            }
+            if (write) {
+                *slot = (void *)addr;
+                *(slot + 1) = new_ufile->membase;
+            }
+            continue;
+
+        case R_ARM_FUNCDESC:
+            fd = *slot;
+            if (!fd || *(fd + 1) != old_ufile->membase) {
+                continue;
+            }
+            addr = uld_dyn_swap_translate(old_ufile, new_ufile, name, *fd);
+            if (!addr) {
+                break;
+            }
+            // A descriptor owned by the old file is freed with it and one
+            // in the fdtab area is read only, use a canonical descriptor
+            // instead.
+            if (uld_dyn_swap_in_file(old_ufile, fd) ||
+                    uld_dyn_in_fdtab(fd)) {
+                (*fd_count)++;
+                if (!write) {
+                    continue;
+                }
+                fd = (void **)uld_dyn_dlsym_funcdesc(addr,
+                        new_ufile->membase);
+                // Reserved by the check pass.
+                if (!fd) {
+                    swbkpt();
+                    return -1;
+                }
+                *slot = fd;
+            } else if (write) {
+                *fd = (void *)addr;
+                *(fd + 1) = new_ufile->membase;
+            }
+            continue;
+
+        default:
+            continue;
+        }
+
+        printf("swap: %s not found in %s (imported by %s)\n", name,
+                new_ufile->fse->name, importer->fse->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Translate the function descriptor fp/fb of an exported function in
+// old_ufile to new_ufile.  Returns -1 if new_ufile does not export it.
+static int uld_dyn_swap_funcdesc(const struct uld_file *old_ufile,
+        const struct uld_file *new_ufile, const void **fp, const void **fb)
+{
+    const struct elf32_sym *sym;
+    struct uld_section *dynstr_sec;
+    const void *addr;
+    unsigned int idx;
+
+    addr = NULL;
+    dynstr_sec = uld_file_get_sec_dynstr(old_ufile);
+    uld_dyn_for_each_dynsym_file(sym, idx, old_ufile) {
+        if (ELF32_ST_TYPE(sym->st_info) == STT_FUNC &&
+                elf32_sym_has_section_index(sym) &&
+                uld_file_lma_to_adjusted_vma(old_ufile,
+                (void *)sym->st_value) == *fp) {
+            addr = uld_dyn_swap_translate(old_ufile, new_ufile,
+                    uld_dyn_get_sym_name(sym, dynstr_sec), *fp);
+            break;
+        }
+    }
+
+    if (!addr) {
+        return -1;
+    }
+
+    *fp = addr;
+    *fb = new_ufile->membase;
+
+    return 0;
+}
+
+// Repoint descriptors handed out by uld_dyn_dlsym.  The symbol is found by
+// address since the name is not kept.
+static void uld_dyn_swap_dlsym_funcdesc(const struct uld_file *old_ufile,
+        const struct uld_file *new_ufile)
+{
+    struct uld_dyn_funcdesc *fd;
+    int i;
+
+    for (i = 0; i < ULD_DYN_DLSYM_FUNCDESC_MAX; i++) {
+        fd = &uld_dyn_state.dlsym_fd[i];
+        if (!fd->fp || fd->fb != old_ufile->membase) {
+            continue;
+        }
+
+        if (uld_dyn_swap_funcdesc(old_ufile, new_ufile, &fd->fp, &fd->fb)) {
+            printf("swap: dlsym pointer %p not in %s\n", fd->fp,
+                    new_ufile->fse->name);
+        }
+    }
+}
+
+// Move IRQ handlers to the new version.  Handlers it does not export are
+// released with the old version.
+static void uld_dyn_swap_irq(const struct uld_file *old_ufile,
+        const struct uld_file *new_ufile)
+{
+    const uint8_t *base = old_ufile->fse->base;
+    struct uld_irq_entry entry;
+    int i;
+
+    for (i = 0; i < CONFIG_CPU_IRQ_NUM; i++) {
+        entry = uld_irq_table[i];
+        if ((const uint8_t *)entry.fp < base ||
+                (const uint8_t *)entry.fp >= base + old_ufile->fse->size) {
+            continue;
+        }
+
+        if (uld_dyn_swap_funcdesc(old_ufile, new_ufile, &entry.fp,
+                &entry.fb)) {
+            printf("swap: irq %d handler %p not in %s\n", i, entry.fp,
+                    new_ufile->fse->name);
+            continue;
+        }
+        uld_irq_register(i, &entry);
+    }
+}
+
+int uld_dyn_swap(const char *old_name, const char *new_name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_file *old_ufile;
+    struct uld_file *new_ufile;
+    struct uld_swap_info info;
+    const struct uld_fs_entry *old_fse;
+    const struct uld_fs_entry *new_fse;
+    const struct uld_fs_entry **dep_list;
+    const struct elf32_sym *sym;
+    const void *addr;
+    uint32_t old_bit;
+    int fse_count;
+    int dep_count;
+    int fd_count;
+    int old_idx;
+    int new_idx;
+    int i;
+
+    if (!old_name || !new_name) {
+        return -1;
+    }
+
+    old_fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), old_name);
+    new_fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), new_name);
+    if (!old_fse || !new_fse) {
+        printf("swap: could not find %s or %s\n", old_name, new_name);
+        return -1;
+    }
+
+    old_idx = uld_dyn_find_loaded_fse(old_fse);
+    if (old_idx < 0 || uld_dyn_find_loaded_fse(new_fse) >= 0 ||
+            (ds->ufile_list[old_idx].flags & ULD_FILE_FLAG_EXEC)) {
+        printf("swap: %s must be a loaded library and %s not loaded\n",
+                old_name, new_name);
+        return -1;
+    }
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    dep_count = uld_dyn_get_closure(new_fse, dep_list, fse_count);
+    if (dep_count <= 0 || uld_dyn_load_dep_list(dep_list, dep_count)) {
+        printf("swap: could not load %s\n", new_name);
+        return -1;
+    }
+
+    // Loading only appends files so old_idx is unchanged.
+    new_idx = uld_dyn_find_loaded_fse(new_fse);
+    old_ufile = &ds->ufile_list[old_idx];
+    new_ufile = &ds->ufile_list[new_idx];
+    old_bit = 1 << old_idx;
+
+    // Check every importer can be repointed and enough uld_dyn_dlsym
+    // descriptors are free before changing anything.
+    fd_count = 0;
+    for (i = 0; i < ds->file_count; i++) {
+        if ((ds->ufile_list[i].res_mask & old_bit) &&
+                (i == new_idx || uld_dyn_swap_importer(&ds->ufile_list[i],
+                old_ufile, new_ufile, 0, &fd_count))) {
+            break;
+        }
+    }
+    if (i < ds->file_count || fd_count > uld_dyn_dlsym_funcdesc_free()) {
+        printf("swap: can not replace %s with %s\n", old_name, new_name);
+        uld_dyn_release_unused();
+        return -1;
+    }
+
+    sym = uld_dyn_find_dynsym_elf_hash_file(ULD_SWAP_MIGRATE_SYM, new_ufile);
+    if (sym && elf32_sym_has_section_index(sym) &&
+            ELF32_ST_TYPE(sym->st_info) == STT_FUNC) {
+        addr = uld_file_lma_to_adjusted_vma(new_ufile,
+                (void *)sym->st_value);
+        info.old_membase = old_ufile->membase;
+        info.old_memsz = old_ufile->memsz;
+        info.old_name = old_fse->name;
+        if (uld_verbose) {
+            printf("swap: migrating %s to %s\n", old_name, new_name);
+        }
+        uld_exec_call_vp_fp_fdpic_base((void (*)(void *))addr, &info,
+                (uint32_t)new_ufile->membase);
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        if (ds->ufile_list[i].res_mask & old_bit) {
+            uld_dyn_swap_importer(&ds->ufile_list[i], old_ufile, new_ufile, 1,
+                    &fd_count);
+            ds->ufile_list[i].res_mask &= ~old_bit;
+            ds->ufile_list[i].res_mask |= 1 << new_idx;
+        }
+    }
+    uld_dyn_swap_dlsym_funcdesc(old_ufile, new_ufile);
+    uld_dyn_swap_irq(old_ufile, new_ufile);
+
+    // Hand over references, the old file's state was migrated so its
+    // destructors are not run.
+    new_ufile->refcount = old_ufile->refcount;
+    new_ufile->dlopen_count = old_ufile->dlopen_count;
+    new_ufile->flags |= old_ufile->flags &
+            (ULD_FILE_FLAG_DLOPEN | ULD_FILE_FLAG_BOOT);
+    old_ufile->refcount = 0;
+    old_ufile->dlopen_count = 0;
+    old_ufile->flags &= ~(ULD_FILE_FLAG_INIT_DONE | ULD_FILE_FLAG_BOOT);
+
+    printf("swapped %s for %s\n", old_name, new_name);
+    uld_dyn_release_unused();
+    uld_reloc_update_plt(ds->ufile_list, ds->file_count);
+    uld_warm_update();
+
+    return 0;
+}
+
+// Dependencies of fse must be loaded before file_idx (or be lazy) for it
+// to be relinked in place.
+static int uld_dyn_relink_check_needed(const struct uld_fs_entry *fse,
+        int file_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_file *ufile = &ds->ufile_list[file_idx];
+    struct uld_section dyn_sec;
+    struct uld_section dynstr_sec;
+    const struct elf32_dyn *dyn;
+    const struct uld_fs_entry *dep_fse;
+    const char *dep_name;
+    int found;
+    int ret;
+    int i;
+
+    ret = uld_dyn_create_fse_dep_list_get_sections(fse, &dyn_sec, &dynstr_sec);
+    if (ret) {
+        return ret < 0 ? ret : 0;
+    }
+
+    uld_dyn_for_each_dt_needed(dyn, &dyn_sec) {
+        dep_name = ((const char *)dynstr_sec.adjusted_lma) + dyn->d_un.d_val;
+        dep_fse = uld_fs_get_file_by_name(ULD_PSTORE->fs_table_pri.head,
+                dep_name);
+        if (!dep_fse) {
+            return -1;
+        }
+
+        found = 0;
+        for (i = 0; i < file_idx && !found; i++) {
+            found = ds->ufile_list[i].fse == dep_fse &&
+                    ds->ufile_list[i].instance == ufile->instance;
+        }
+        for (i = 0; i < ds->lazy_count && !found; i++) {
+            found = ds->lazy_fse[i] == dep_fse;
+        }
+        if (!found) {
+            printf("relink: %s needs %s\n", fse->name, dep_name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Write a FUNCDESC resolution of an importer being relinked.  A descriptor
+// the importer allocated in its dl_alloc pool is rewritten in place so the
+// pool does not grow.
+static int uld_dyn_relink_funcdesc(const struct uld_file *ufile_list,
+        int file_idx, const struct elf32_rel *rel,
+        const struct uld_dyn_resolution *res)
+{
+    const struct uld_file *rel_ufile = &ufile_list[file_idx];
+    const struct uld_file *res_ufile = &ufile_list[res->file_idx];
+    const uint8_t *addr;
+    void **rel_dst;
+    void *ptr;
+
+    rel_dst = (void **)uld_file_lma_to_adjusted_vma(rel_ufile,
+            (void *)rel->r_offset);
+    if (!rel_dst) {
+        return -1;
+    }
+
+    if (!res->membase) {
+        ptr = res->ptr;
+    } else {
+        addr = uld_file_lma_to_adjusted_vma(res_ufile, res->ptr);
+        ptr = (void *)uld_reloc_get_fdtab_funcdesc(res_ufile, addr);
+        if (!ptr && uld_dyn_rel_in_flash(rel_ufile, rel)) {
+            printf("  FUNCDESC in flash needs a flash descriptor table for "
+                    "%s\n", res_ufile->fse->name);
+            return -1;
+        } else if (!ptr && (uint8_t *)*rel_dst >= rel_ufile->dl_alloc_base &&
+                (uint8_t *)*rel_dst < rel_ufile->dl_alloc_base +
+                rel_ufile->dl_alloc_size) {
+            ptr = *rel_dst;
+            uld_dyn_write_reso_funcdesc_value_dst((void **)ptr, ufile_list,
+                    res);
+        } else if (!ptr) {
+            ptr = (void *)uld_dyn_dlsym_funcdesc(addr, res->membase);
+            if (!ptr) {
+                return -1;
+            }
+        }
+    }
+
+    if (uld_dyn_store_rel_dst(rel_ufile, rel, rel_dst, ptr)) {
+        return -1;
+    }
+    uprintf("  Wrote FUNCDESC %p to %p\n", ptr, rel_dst);
+
+    return 0;
+}
+
+// Returns 1 if addr is in the memory or flash of a file in relink_mask.
+// The relinked file moved_idx was at old_base in flash.
+static int uld_dyn_relink_in_mask(const struct uld_file *ufile_list,
+        int file_count, uint32_t relink_mask, int moved_idx,
+        const uint8_t *old_base, const void *addr)
+{
+    const struct uld_file *ufile;
+    const uint8_t *p = addr;
+    const uint8_t *base;
+    int i;
+
+    for (i = 0; i < file_count; i++) {
+        if (!(relink_mask & (1 << i))) {
+            continue;
+        }
+        ufile = &ufile_list[i];
+        base = ufile->fse->base;
+        if ((p >= ufile->membase && p < ufile->membase + ufile->memsz) ||
+                (p >= base && p < base + ufile->fse->size) ||
+                (i == moved_idx && p >= old_base &&
+                p < old_base + ufile->fse->size)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Returns 1 if the slot of rel in importer file_idx still holds a value
+// bound into a file in relink_mask.  Function descriptors are matched by
+// their FDPIC base.
+static int uld_dyn_relink_slot_in_mask(const struct uld_file *ufile_list,
+        int file_idx, int file_count, uint32_t relink_mask, int moved_idx,
+        const uint8_t *old_base, const struct elf32_rel *rel)
+{
+    void **slot;
+    void **fd;
+    int i;
+
+    slot = (void **)uld_file_lma_to_adjusted_vma(&ufile_list[file_idx],
+            (void *)rel->r_offset);
+    if (!slot) {
+        return 0;
+    }
+
+    switch (ELF32_R_TYPE(rel->r_info)) {
+    case R_ARM_FUNCDESC:
+        fd = *slot;
+        break;
+
+    case R_ARM_FUNCDESC_VALUE:
+        fd = slot;
+        break;
+
+    default:
+        return uld_dyn_relink_in_mask(ufile_list, file_count, relink_mask,
+                moved_idx, old_base, *slot);
+    }
+
+    if (!fd) {
+        return 0;
+    }
+    for (i = 0; i < file_count; i++) {
+        if ((relink_mask & (1 << i)) && ufile_list[i].membase &&
+                *(fd + 1) == ufile_list[i].membase) {
+            return 1;
+        }
+    }
+
+    return uld_dyn_relink_in_mask(ufile_list, file_count, relink_mask,
+            moved_idx, old_base, *fd);
+}
+
+// Resolve the relocations of importer file_idx again and write those that
+// resolve into a file in relink_mask.  The rest keep their GOT contents.  A
+// slot bound into a file in relink_mask that no longer resolves into one
+// would be left stale and fails.  Returns 1 if a relocation was written, 0
+// if none or -1 on error.
+static int uld_dyn_relink_importer(struct uld_file *ufile_list,
+        int file_idx, int file_count, uint32_t relink_mask, int moved_idx,
+        const uint8_t *old_base)
+{
+    struct uld_dyn_resolution res;
+    struct uld_file *ufile = &ufile_list[file_idx];
+    struct uld_section *rel_dyn_sec;
+    struct uld_section *dynsym_sec;
+    struct uld_section *dynstr_sec;
+    const struct elf32_rel *rel;
+    int flash_count = 0;
+    int written = 0;
+    int ret;
+    unsigned int rd_idx;
+
+    uld_dyn_get_link_sections(ufile, NULL, &rel_dyn_sec, &dynsym_sec,
+            &dynstr_sec);
+    if (!rel_dyn_sec) {
+        return 0;
+    }
+
+    uld_dyn_for_each_rel_dyn_sec(rel, rd_idx, rel_dyn_sec) {
+        if (ELF32_R_TYPE(rel->r_info) == R_ARM_RELATIVE) {
+            continue;
+        }
+        if (uld_dyn_rel_in_flash(ufile, rel)) {
+            flash_count++;
+        }
+
+        // Unresolved imports were bound to uld_dyn_lazy_stub and are kept.
+        if (uld_dyn_resolve_rel(ufile_list, rel, file_idx, rd_idx, &res) ||
+                res.file_idx == file_idx ||
+                !(relink_mask & (1 << res.file_idx))) {
+            if (uld_dyn_relink_slot_in_mask(ufile_list, file_idx, file_count,
+                    relink_mask, moved_idx, old_base, rel)) {
+                printf("[<%p>] relink stale import %02d:%02d\n", rel,
+                        file_idx, rd_idx);
+                return -1;
+            }
+            continue;
+        }
+
+        uld_dyn_record_resolution(ufile_list, file_idx, rel, &res,
+                dynsym_sec, dynstr_sec);
+
+        switch (ELF32_R_TYPE(rel->r_info)) {
+        case R_ARM_ABS32:
+            ret = uld_dyn_write_reso_abs32(ufile_list, file_idx, rel, &res);
+            break;
+
+        case R_ARM_GLOB_DAT:
+            // Objects without a definition would need dl_alloc space.
+            ret = res.ptr ? uld_dyn_write_reso_glob_dat(ufile_list, file_idx,
+                    rel, &res, NULL, NULL, NULL) : -1;
+            break;
+
+        case R_ARM_FUNCDESC:
+            ret = uld_dyn_relink_funcdesc(ufile_list, file_idx, rel, &res);
+            break;
+
+        case R_ARM_FUNCDESC_VALUE:
+            ret = uld_dyn_write_reso_funcdesc_value(ufile_list, file_idx,
+                    rel, &res);
+            break;
+
+        default:
+            ret = -1;
+            break;
+        }
+
+        if (ret) {
+            printf("[<%p>] relink failed %02d:%02d\n", rel, file_idx, rd_idx);
+            return -1;
+        }
+        written = 1;
+    }
+
+    if (flash_count && uld_dyn_finish_flash_bind(ufile,
+            uld_dyn_calc_bind_stamp(ufile_list, file_idx, file_count))) {
+        printf("%s: flash relocations not stamped\n", ufile->fse->name);
+        return -1;
+    }
+
+    return written;
+}
+
+int uld_dyn_relink_file(int file_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_file *ufile;
+    struct uld_file old;
+    struct uld_section *sec_start;
+    const struct uld_fs_entry *fse;
+    const uint8_t *old_base;
+    uint32_t relink_mask;
+    size_t memsz;
+    int importer_count = 0;
+    int sec_num;
+    int ret;
+    int i;
+
+    if (file_idx < 0 || file_idx >= ds->file_count) {
+        return -1;
+    }
+
+    ufile = &ds->ufile_list[file_idx];
+    fse = ufile->fse;
+    sec_num = uld_file_get_sec_count(ufile);
+    memsz = uld_load_get_fse_mem_size(fse);
+
+    // The file keeps its section slots, membase and stack.
+    if ((fse->flags & (ULD_FS_ENTRY_FLAG_RAM |
+            ULD_FS_ENTRY_FLAG_OVERLAY_MASK)) ||
+            uld_load_get_sec_count(fse->base, NULL,
+            ULD_DYN_LOAD_SECTION_TYPE_MASK) != sec_num ||
+            memsz > ufile->memsz || !memsz != !ufile->memsz ||
+            ((ufile->flags & ULD_FILE_FLAG_EXEC) && ds->stack_size &&
+            uld_fs_get_stack_size(fse) != ds->stack_size) ||
+            uld_dyn_relink_check_needed(fse, file_idx)) {
+        printf("relink: %s does not fit its old place\n", fse->name);
+        return -1;
+    }
+
+    sec_start = ds->sec_list;
+    for (i = 0; i < file_idx; i++) {
+        sec_start += uld_file_get_sec_count(&ds->ufile_list[i]);
+    }
+
+    uld_dyn_release_dlsym_funcdesc(ufile);
+    uld_dyn_release_lazy_import(ufile);
+    if (ufile->dl_alloc_size) {
+        uld_mem_free(ufile->dl_alloc_base, ufile->dl_alloc_size);
+    }
+
+    // Sections still describe the old version.
+    old = *ufile;
+    old_base = (const uint8_t *)sec_start->ehdr;
+    ret = uld_load_file_at(fse, sec_start, sec_num,
+            ULD_DYN_LOAD_SECTION_TYPE_MASK, old.membase, ufile);
+    if (ret) {
+        return ret;
+    }
+    if (memsz) {
+        memset(ufile->membase + memsz, 0, old.memsz - memsz);
+        ufile->memsz = old.memsz;
+    }
+    ufile->data_image = old.data_image;
+    ufile->heap_base = old.heap_base;
+    ufile->heap_size = old.heap_size;
+    ufile->flags = old.flags;
+    ufile->refcount = old.refcount;
+    ufile->dlopen_count = old.dlopen_count;
+    ufile->instance = old.instance;
+
+    // Same order as uld_dyn_exec_fse.
+    uld_reloc_update_fdtab(ds->ufile_list, ds->file_count);
+    ret = uld_dyn_link_alloc_file_list(ds->ufile_list, file_idx,
+            file_idx + 1);
+    if (ret) {
+        return ret;
+    }
+
+    // Importers recorded as resolving into the file, or into an importer
+    // whose GOT changed, are resolved again.  Lazily bound files are not
+    // in the boot set so only later files can import from it.
+    relink_mask = 1 << file_idx;
+    for (i = file_idx + 1; i < ds->file_count; i++) {
+        if (ds->ufile_list[i].instance != ufile->instance ||
+                !(ds->ufile_list[i].res_mask & relink_mask)) {
+            continue;
+        }
+
+        ret = uld_dyn_relink_importer(ds->ufile_list, i, ds->file_count,
+                relink_mask, file_idx, old_base);
+        if (ret < 0) {
+            return ret;
+        }
+        if (ret) {
+            relink_mask |= 1 << i;
+            importer_count++;
+        }
+    }
+
+    uld_reloc_update_plt(ds->ufile_list, ds->file_count);
+
+    printf("relinked: %-16s %d importers\n", fse->name, importer_count);
+
+    return 0;
+}
+
+// Rewrite every function descriptor (FUNCDESC_VALUE slots and descriptors
+// referenced by FUNCDESC) equal to old_fp/old_fb in files of the current
+// instance, uld_dyn_dlsym descriptors and IRQ handlers.  FUNCDESC slots
+// using a descriptor in the fdtab area are repointed to a uld_dyn_dlsym
+// descriptor, slots in flash sections are left.  Returns the number
+// rewritten.
+static int uld_dyn_patch_redirect(const void *old_fp, const void *old_fb,
+        const void *new_fp, const void *new_fb, int patch_idx)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_file *ufile;
+    struct uld_dyn_funcdesc *dfd;
+    struct uld_irq_entry entry;
+    const struct elf32_rel *rel;
+    const void **slot;
+    const void **fd;
+    unsigned int idx;
+    int count = 0;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        if (i == patch_idx || ufile->instance != ds->instance ||
+                !uld_file_get_sec_rel_dyn(ufile)) {
+            continue;
+        }
+
+        uld_dyn_for_each_rel_dyn_file(rel, idx, ufile) {
+            slot = (const void **)uld_file_lma_to_adjusted_vma(ufile,
+                    (void *)rel->r_offset);
+            if (!slot) {
+                continue;
+            }
+
+            if (ELF32_R_TYPE(rel->r_info) == R_ARM_FUNCDESC) {
+                fd = *(const void ***)slot;
+            } else if (ELF32_R_TYPE(rel->r_info) == R_ARM_FUNCDESC_VALUE) {
+                fd = slot;
+            } else {
+                continue;
+            }
+
+            if (!fd || fd[0] != old_fp || fd[1] != old_fb) {
+                continue;
+            }
+
+            if (uld_dyn_rel_in_flash(ufile, rel)) {
+                printf("patch: %s descriptor %p in flash not redirected\n",
+                        ufile->fse->name, (void *)slot);
+                continue;
+            }
+
+            if (uld_dyn_in_fdtab(fd)) {
+                fd = (const void **)uld_dyn_dlsym_funcdesc(new_fp, new_fb);
+                if (!fd) {
+                    printf("patch: no dlsym descriptor for %p\n", new_fp);
+                    continue;
+                }
+                *slot = fd;
+            } else {
+                fd[0] = new_fp;
+                fd[1] = new_fb;
+            }
+            // Patched calls now depend on the patch module.
+            ufile->res_mask |= 1 << patch_idx;
+            count++;
+        }
+    }
+
+    for (i = 0; i < ULD_DYN_DLSYM_FUNCDESC_MAX; i++) {
+        dfd = &ds->dlsym_fd[i];
+        if (dfd->fp == old_fp && dfd->fb == old_fb) {
+            dfd->fp = new_fp;
+            dfd->fb = new_fb;
+            count++;
+        }
+    }
+
+    for (i = 0; i < CONFIG_CPU_IRQ_NUM; i++) {
+        entry = uld_irq_table[i];
+        if (entry.fp == old_fp && entry.fb == old_fb) {
+            entry.fp = new_fp;
+            entry.fb = new_fb;
+            uld_irq_register(i, &entry);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int uld_dyn_patch(const char *patch_name, const char *target_name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry *patch_fse;
+    const struct uld_fs_entry *target_fse;
+    const struct uld_fs_entry **dep_list;
+    const struct uld_file *patch;
+    const struct uld_file *target;
+    const struct elf32_sym *sym;
+    const struct elf32_sym *target_sym;
+    struct uld_section *dynstr_sec;
+    const char *name;
+    const void *old_fp;
+    const void *new_fp;
+    unsigned int idx;
+    int fse_count;
+    int dep_count;
+    int patch_idx;
+    int target_idx;
+    int count;
+
+    if (!patch_name || !target_name) {
+        return -1;
+    }
+
+    patch_fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), patch_name);
+    target_fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), target_name);
+    if (!patch_fse || !target_fse ||
+            uld_dyn_find_loaded_fse(target_fse) < 0 ||
+            uld_dyn_find_loaded_fse(patch_fse) >= 0) {
+        printf("patch: %s must be loaded and %s not loaded\n", target_name,
+                patch_name);
+        return -1;
+    }
+
+    fse_count = uld_fs_get_file_count(uld_fs_get_fst_head());
+    dep_list = alloca(sizeof(struct uld_fs_entry *) * fse_count);
+    dep_count = uld_dyn_get_closure(patch_fse, dep_list, fse_count);
+    if (dep_count <= 0 || uld_dyn_load_dep_list(dep_list, dep_count)) {
+        printf("patch: could not load %s\n", patch_name);
+        return -1;
+    }
+
+    patch_idx = uld_dyn_find_loaded_fse(patch_fse);
+    target_idx = uld_dyn_find_loaded_fse(target_fse);
+    patch = &ds->ufile_list[patch_idx];
+    target = &ds->ufile_list[target_idx];
+
+    // Every function defined by the patch module that the target also
+    // defines is redirected.
+    dynstr_sec = uld_file_get_sec_dynstr(patch);
+    uld_dyn_for_each_dynsym_file(sym, idx, patch) {
+        if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC ||
+                !elf32_sym_has_section_index(sym)) {
+            continue;
+        }
+
+        name = uld_dyn_get_sym_name(sym, dynstr_sec);
+        target_sym = uld_dyn_find_dynsym_elf_hash_file(name, target);
+        if (!target_sym || !elf32_sym_has_section_index(target_sym) ||
+                ELF32_ST_TYPE(target_sym->st_info) != STT_FUNC) {
+            continue;
+        }
+
+        old_fp = uld_file_lma_to_adjusted_vma(target,
+                (void *)target_sym->st_value);
+        new_fp = uld_file_lma_to_adjusted_vma(patch, (void *)sym->st_value);
+        count = uld_dyn_patch_redirect(old_fp, target->membase, new_fp,
+                patch->membase, patch_idx);
+        printf("patch: %s::%s -> %s (%d descriptors)\n", target_name, name,
+                patch_name, count);
+    }
+
+    uld_reloc_update_plt(ds->ufile_list, ds->file_count);
+    uld_warm_update();
+
+    return 0;
+}
+
+int uld_dyn_overlay(const char *name)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_fs_entry *fse;
+
+    // Runtime services require a set loaded by uld_dyn_exec_fse.
+    if (!name || !ds->file_count) {
+        return -1;
+    }
+
+    fse = uld_fs_get_file_by_name(uld_fs_get_fst_head(), name);
+    if (!fse || !uld_fs_get_overlay(fse)) {
+        printf("overlay: %s is not an overlay member\n", name);
+        return -1;
+    }
+
+    printf("overlay %u: activate %s\n", uld_fs_get_overlay(fse), name);
+
+    return uld_dyn_bind_lazy_fse(fse);
 }
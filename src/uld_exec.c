@@ -22,6 +22,7 @@
 
 #include "uld.h"
 #include "uld_exec.h"
+#include "uld_file.h"
 
 
 const char * const uld_exec_init_section_list[] = {
@@ -29,6 +30,10 @@ const char * const uld_exec_init_section_list[] = {
     ".init_array"
 };
 
+const char * const uld_exec_fini_section_list[] = {
+    ".fini_array"
+};
+
 
 void uld_exec_call_vv_fp_array(void (**arr_start)(void),
         void (**arr_end)(void))
@@ -60,13 +65,31 @@ void uld_exec_call_vv_fp_array_fdpic_base(void (**arr_start)(void),
     }
 }
 
+void uld_exec_call_vv_fp_array_rev_fdpic_base(void (**arr_start)(void),
+        void (**arr_end)(void), uint32_t fdpic_base)
+{
+    if (!arr_start || !arr_end) {
+        return;
+    }
 
-int uld_exec_elf_call_init_funcs(struct uld_file *ufile)
+    while (arr_end > arr_start) {
+        arr_end--;
+        if (*arr_end) {
+            uld_exec_call_vv_fp_fdpic_base(*arr_end, fdpic_base);
+        }
+    }
+}
+
+
+static int uld_exec_elf_call_section_funcs(struct uld_file *ufile,
+        const char * const *sec_names, int count, const char *desc,
+        int reverse)
 {
     const struct elf32_ehdr *ehdr;
-    const struct elf32_shdr *init_shdr;
+    const struct elf32_shdr *shdr;
     void (**arr_start)(void);
-    unsigned int i;
+    void (**arr_end)(void);
+    int i;
 
     if (!ufile) {
         return -1;
@@ -74,29 +97,45 @@ int uld_exec_elf_call_init_funcs(struct uld_file *ufile)
 
     ehdr = ufile->fse->base;
 
-    for (i = 0; i < sizeof(uld_exec_init_section_list) / sizeof(char *); i++) {
-        init_shdr = elf32_get_section_by_name(ehdr, NULL,
-                uld_exec_init_section_list[i]);
-        if (!init_shdr) {
+    for (i = 0; i < count; i++) {
+        shdr = elf32_get_section_by_name(ehdr, NULL, sec_names[i]);
+        if (!shdr) {
             continue;
         }
 
-        arr_start = (void (**)(void))elf32_get_section_flash_addr(
-                init_shdr, ehdr);
+        arr_start = (void (**)(void))elf32_get_section_flash_addr(shdr, ehdr);
+        arr_end = arr_start + (shdr->sh_size / sizeof(void *));
         if (uld_verbose) {
-            printf("calling %ld init functions in %s - %s [<%p>]\n",
-                    init_shdr->sh_size / sizeof(void *), ufile->fse->name,
-                    uld_exec_init_section_list[i], arr_start);
+            printf("calling %ld %s functions in %s - %s [<%p>]\n",
+                    shdr->sh_size / sizeof(void *), desc, ufile->fse->name,
+                    sec_names[i], arr_start);
         }
 
-        uld_exec_call_vv_fp_array_fdpic_base(arr_start,
-                arr_start + (init_shdr->sh_size / sizeof(void *)),
-                (uint32_t)ufile->membase);
+        if (reverse) {
+            uld_exec_call_vv_fp_array_rev_fdpic_base(arr_start, arr_end,
+                    (uint32_t)ufile->membase);
+        } else {
+            uld_exec_call_vv_fp_array_fdpic_base(arr_start, arr_end,
+                    (uint32_t)ufile->membase);
+        }
     }
 
     return 0;
 }
 
+int uld_exec_elf_call_init_funcs(struct uld_file *ufile)
+{
+    return uld_exec_elf_call_section_funcs(ufile, uld_exec_init_section_list,
+            sizeof(uld_exec_init_section_list) / sizeof(char *), "init", 0);
+}
+
+int uld_exec_elf_call_fini_funcs(struct uld_file *ufile)
+{
+    // Destructors are called in reverse order of constructors.
+    return uld_exec_elf_call_section_funcs(ufile, uld_exec_fini_section_list,
+            sizeof(uld_exec_fini_section_list) / sizeof(char *), "fini", 1);
+}
+
 int uld_exec_file(const struct uld_file *ufile, void *sp_base, int argc,
         const char **argv)
 {
@@ -108,7 +147,7 @@ int uld_exec_file(const struct uld_file *ufile, void *sp_base, int argc,
         return -1;
     }
 
-    entryfp = elf32_get_adjusted_entry(ufile->fse->base, NULL);
+    entryfp = uld_file_get_adjusted_entry(ufile);
 
     sp_base = (void *)((uintptr_t)sp_base & ~0x7);
 
@@ -173,3 +173,16 @@ const void *uld_file_lma_to_adjusted_vma(const struct uld_file *ufile,
 {
     return uld_file_lma_to_adjusted_ma(ufile, lma, 0);
 }
+
+const void *uld_file_get_adjusted_entry(const struct uld_file *ufile)
+{
+    const struct elf32_ehdr *ehdr = (const struct elf32_ehdr *)ufile->fse->base;
+    const void *entry;
+
+    entry = uld_file_lma_to_adjusted_vma(ufile, (const void *)ehdr->e_entry);
+    if (!entry) {
+        entry = elf32_get_adjusted_entry(ehdr, NULL);
+    }
+
+    return entry;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_dyn.h"
+#include "uld_file.h"
+#include "uld_flat.h"
+#include "uld_fs.h"
+#include "uld_mem.h"
+#include "uld_reloc.h"
+#include "uld_sal.h"
+#include "util.h"
+
+
+// The file list, section list and the rest of uld_dyn_state are followed by
+// the initialized memory and dl_alloc pool of each file.
+#define ULD_FLAT_STATE_PART_COUNT                   3
+#define ULD_FLAT_PART_MAX \
+    (ULD_FLAT_STATE_PART_COUNT + ULD_DYN_FILE_MAX * 2)
+
+
+struct uld_flat_part {
+    void *ptr;
+    size_t size;
+};
+
+
+// Size of the part of ufile's memory holding initialized sections, the rest
+// is .bss.
+static size_t uld_flat_get_init_size(const struct uld_file *ufile)
+{
+    const struct uld_section *sec;
+    size_t size = 0;
+    size_t end;
+    int i;
+
+    for (i = 0; i < ufile->num.mem; i++) {
+        sec = &ufile->sec.mem[i];
+        if (sec->shdr->sh_type == SHT_NOBITS) {
+            continue;
+        }
+        end = (const uint8_t *)sec->adjusted_vma + sec->shdr->sh_size -
+                ufile->membase;
+        size = MAX(size, end);
+    }
+
+    return MIN(size, ufile->memsz);
+}
+
+// Parts of the image in the order they follow the header.  The memory parts
+// are taken from the file list of ds.  Returns the number of parts.
+static int uld_flat_get_parts(struct uld_dyn_state *ds,
+        struct uld_flat_part *part)
+{
+    struct uld_file *ufile;
+    int count = 0;
+    int i;
+
+    part[count].ptr = ds->ufile_list;
+    part[count++].size = sizeof(struct uld_file) * ds->file_count;
+    part[count].ptr = ds->sec_list;
+    part[count++].size = sizeof(struct uld_section) * ds->sec_count;
+    part[count].ptr = ds->dlsym_fd;
+    part[count++].size = (uint8_t *)(ds + 1) - (uint8_t *)ds->dlsym_fd;
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        part[count].ptr = ufile->membase;
+        part[count++].size = uld_flat_get_init_size(ufile);
+        part[count].ptr = ufile->dl_alloc_base;
+        part[count++].size = ufile->dl_alloc_size;
+    }
+
+    return count;
+}
+
+int uld_flat_save(void)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_flat_part part[ULD_FLAT_PART_MAX];
+    const struct uld_file *ufile;
+    struct uld_flat_hdr hdr;
+    uint8_t *dest;
+    size_t size;
+    int part_count;
+    int was_locked;
+    int ret;
+    int i;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ULD_FLAT_MAGIC;
+    hdr.exec_fse = ds->ufile_list[ds->exec_idx].fse;
+    hdr.state = ds;
+    hdr.state_size = sizeof(struct uld_dyn_state);
+    hdr.pstore_crc = uld_crc_calc_pstore();
+    hdr.file_count = ds->file_count;
+    hdr.sec_count = ds->sec_count;
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        // Text and memory of these files can move between boots.
+        if (ufile->text_image || (ufile->flags & ULD_FILE_FLAG_OVERLAY)) {
+            printf("flat: %s can not be flattened\n", ufile->fse->name);
+            return -1;
+        }
+        hdr.file[i].fse = ufile->fse;
+        hdr.file[i].base = ufile->fse->base;
+        hdr.file[i].crc = ufile->fse->crc;
+        hdr.file[i].fdtab = uld_reloc_find_fdtab(ufile->fse);
+    }
+
+    part_count = uld_flat_get_parts(ds, part);
+    for (i = 0; i < part_count; i++) {
+        size = ALIGN(part[i].size, 2);
+        hdr.size += size;
+    }
+
+    if (sizeof(hdr) + hdr.size > ULD_FLAT_SIZE) {
+        printf("flat: %d bytes exceeds %d\n", (int)(sizeof(hdr) + hdr.size),
+                (int)ULD_FLAT_SIZE);
+        return -1;
+    }
+
+    was_locked = cpu_flash_is_locked();
+    if (was_locked) {
+        cpu_flash_unlock();
+    }
+
+    // Header is written last so an interrupted save is never valid.
+    ret = cpu_flash_erase(ULD_FLAT_BASE, ULD_FLAT_SIZE);
+    dest = ULD_FLAT_BASE + sizeof(hdr);
+    for (i = 0; i < part_count && !ret; i++) {
+        if (part[i].size) {
+            ret = cpu_flash_write(dest, part[i].ptr, part[i].size);
+        }
+        size = ALIGN(part[i].size, 2);
+        dest += size;
+    }
+    if (!ret) {
+        hdr.crc = crc32(ULD_FLAT_BASE + sizeof(hdr), hdr.size,
+                UTIL_CRC32_INIT);
+        ret = cpu_flash_write(ULD_FLAT_BASE, &hdr, sizeof(hdr));
+    }
+
+    if (was_locked) {
+        cpu_flash_lock();
+    }
+
+    if (!ret) {
+        printf("flat image saved: %s %d files %d bytes\n",
+                hdr.exec_fse->name, hdr.file_count,
+                (int)(sizeof(hdr) + hdr.size));
+    }
+
+    return ret;
+}
+
+int uld_flat_restore(const struct uld_fs_entry *exec_fse)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_flat_part part[ULD_FLAT_PART_MAX];
+    const struct uld_flat_hdr *hdr;
+    const struct uld_flat_file *file;
+    const struct uld_file *ufile;
+    const uint8_t *src;
+    size_t size;
+    int part_count;
+    int stale_idx;
+    int i;
+
+    hdr = (const struct uld_flat_hdr *)ULD_FLAT_BASE;
+    if (hdr->magic != ULD_FLAT_MAGIC || hdr->exec_fse != exec_fse ||
+            hdr->state != ds ||
+            hdr->state_size != sizeof(struct uld_dyn_state) ||
+            hdr->file_count <= 0 || hdr->file_count > ULD_DYN_FILE_MAX ||
+            hdr->sec_count < 0 || hdr->sec_count > ULD_DYN_SECTION_MAX ||
+            sizeof(*hdr) + hdr->size > ULD_FLAT_SIZE) {
+        return -1;
+    }
+
+    if (hdr->pstore_crc != uld_crc_calc_pstore()) {
+        printf("flat: preload or memory placement changed\n");
+        return -1;
+    }
+
+    // Files must not have changed, moved or had their descriptor table
+    // rebuilt since the image was saved.  One file that did is relinked on
+    // its own after the restore (see uld_dyn_relink_file).
+    stale_idx = -1;
+    for (i = 0; i < hdr->file_count; i++) {
+        file = &hdr->file[i];
+        if (!uld_fs_has_file(uld_fs_get_fst_head(), file->fse)) {
+            printf("flat: module set changed\n");
+            return -1;
+        }
+        if (file->fse->base == file->base && file->fse->crc == file->crc &&
+                uld_reloc_find_fdtab(file->fse) == file->fdtab) {
+            continue;
+        }
+        if (stale_idx >= 0) {
+            printf("flat: module set changed\n");
+            return -1;
+        }
+        stale_idx = i;
+    }
+
+    if (hdr->crc != crc32(hdr + 1, hdr->size, UTIL_CRC32_INIT)) {
+        printf("flat: crc mismatch\n");
+        return -1;
+    }
+
+    // Loader state is restored first, the memory parts follow from its
+    // file list.
+    memset(ds, 0, sizeof(struct uld_dyn_state));
+    ds->file_count = hdr->file_count;
+    ds->sec_count = hdr->sec_count;
+    uld_flat_get_parts(ds, part);
+    src = (const uint8_t *)(hdr + 1);
+    for (i = 0; i < ULD_FLAT_STATE_PART_COUNT; i++) {
+        memcpy(part[i].ptr, src, part[i].size);
+        size = ALIGN(part[i].size, 2);
+        src += size;
+    }
+
+    if (uld_dyn_reserve_file_list(ds->ufile_list, ds->file_count)) {
+        printf("flat: module memory in use\n");
+        memset(ds, 0, sizeof(struct uld_dyn_state));
+        return -1;
+    }
+
+    part_count = uld_flat_get_parts(ds, part);
+    for (; i < part_count; i++) {
+        if (part[i].size) {
+            memcpy(part[i].ptr, src, part[i].size);
+        }
+        size = ALIGN(part[i].size, 2);
+        src += size;
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        size = uld_flat_get_init_size(ufile);
+        memset(ufile->membase + size, 0, ufile->memsz - size);
+    }
+
+    if (stale_idx >= 0) {
+        printf("flat: %s changed\n", hdr->file[stale_idx].fse->name);
+        if (uld_dyn_relink_file(stale_idx)) {
+            memset(ds, 0, sizeof(struct uld_dyn_state));
+            uld_mem_init();
+            return -1;
+        }
+        // Saved again so the next boot does not relink.
+        uld_flat_save();
+    }
+
+    printf("flat image restored: %s %d files\n", exec_fse->name,
+            ds->file_count);
+
+    return 0;
+}
@@ -61,6 +61,18 @@ const struct uld_fs_entry *uld_fs_get_file_by_name(
     return NULL;
 }
 
+int uld_fs_has_file(const struct uld_fs_entry *head,
+        const struct uld_fs_entry *fse)
+{
+    const struct uld_fs_entry *pos;
+    fst_for_each_entry(pos, head) {
+        if (pos == fse) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 
 const void *uld_fs_find_free_space(struct uld_pstore *pstore, size_t size)
 {
@@ -22,7 +22,12 @@
 
 #include "uld.h"
 #include "cpu.h"
+#include "uld_audit.h"
 #include "uld_exec.h"
+#include "uld_irq.h"
+#include "uld_mem.h"
+#include "uld_sched.h"
+#include "uld_svc.h"
 
 
 extern void (*__preinit_array_start)(void) __weak;
@@ -37,6 +42,7 @@ static void uld_start_hw_init(void)
 {
     cpu_reset_clks();
     cpu_init_clks();
+    cpu_init_cycle_counter();
 }
 
 void uld_start_init(void)
@@ -45,4 +51,9 @@ void uld_start_init(void)
     uld_exec_call_vv_fp_array(&__init_array_start, &__init_array_end);
 
     uld_start_hw_init();
+    uld_mem_init();
+    uld_svc_init();
+    uld_sched_init();
+    uld_irq_init();
+    uld_audit_init();
 }
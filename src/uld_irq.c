@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+#include "uld.h"
+#include "cpu.h"
+#include "uld_irq.h"
+
+
+#define ULD_IRQ_MEASURE_COUNT                       8
+
+struct uld_irq_entry uld_irq_table[CONFIG_CPU_IRQ_NUM];
+uint32_t uld_irq_latency;
+
+extern void __vector_unhandled(void);
+
+
+// uld_irq_veneers has the thumb bit set.
+#define uld_irq_get_veneer(irq) \
+    ((void (*)(void))((uint32_t)uld_irq_veneers + \
+    ((irq) * CPU_IRQ_VENEER_SIZE)))
+
+static void __attribute__((noinline)) uld_irq_measure_handler(void)
+{
+    __asm__ volatile ("" ::: "memory");
+}
+
+// Veneers can be called as functions since pop {r9, pc} returns through lr.
+// Time the first veneer against a direct call of the same handler.
+static void uld_irq_measure(void)
+{
+    void (*veneer)(void) = uld_irq_get_veneer(0);
+    uint32_t direct;
+    uint32_t cycles;
+    int i;
+
+    uld_irq_table[0].fp = (const void *)uld_irq_measure_handler;
+    uld_irq_table[0].fb = NULL;
+
+    uld_irq_latency = 0;
+    for (i = 0; i < ULD_IRQ_MEASURE_COUNT; i++) {
+        direct = cpu_get_cycles();
+        uld_irq_measure_handler();
+        direct = cpu_get_cycles() - direct;
+
+        cycles = cpu_get_cycles();
+        veneer();
+        cycles = cpu_get_cycles() - cycles;
+
+        if (cycles > direct && cycles - direct > uld_irq_latency) {
+            uld_irq_latency = cycles - direct;
+        }
+    }
+
+    uld_irq_table[0].fp = NULL;
+}
+
+void uld_irq_init(void)
+{
+    memset(uld_irq_table, 0, sizeof(uld_irq_table));
+    uld_irq_measure();
+
+    if (uld_verbose && cpu_has_cycles()) {
+        printf("irq veneer latency: %lu cycles\n",
+                (unsigned long)uld_irq_latency);
+    }
+}
+
+int uld_irq_register(int irq, const void *funcdesc)
+{
+    const void * const *fd = funcdesc;
+    uint32_t mask;
+    int exc_num;
+
+    if (irq < 0 || irq >= CONFIG_CPU_IRQ_NUM) {
+        return -1;
+    }
+
+    exc_num = ARM_CORTEX_M_EXC_IRQ0 + irq;
+    mask = 1 << (irq & 31);
+
+    // Disable and restore the default vector before changing the entry so
+    // the veneer never sees a partial descriptor.
+    *(volatile uint32_t *)(ARM_CORTEX_M_NVIC_ICER_ADDR + ((irq >> 5) * 4)) =
+            mask;
+    if (cpu_memvec_set(exc_num, __vector_unhandled)) {
+        return -1;
+    }
+
+    if (!fd) {
+        uld_irq_table[irq].fp = NULL;
+        uld_irq_table[irq].fb = NULL;
+        return 0;
+    }
+
+    uld_irq_table[irq].fp = fd[0];
+    uld_irq_table[irq].fb = fd[1];
+    cpu_memvec_set(exc_num, uld_irq_get_veneer(irq));
+    *(volatile uint32_t *)(ARM_CORTEX_M_NVIC_ISER_ADDR + ((irq >> 5) * 4)) =
+            mask;
+
+    if (uld_verbose && cpu_has_cycles()) {
+        printf("irq %d: %p - %p veneer latency: %lu cycles\n", irq, fd[0],
+                fd[1], (unsigned long)uld_irq_latency);
+    } else {
+        printf("irq %d: %p - %p\n", irq, fd[0], fd[1]);
+    }
+
+    return 0;
+}
+
+void uld_irq_release(const struct uld_file *ufile)
+{
+    const uint8_t *base = ufile->fse->base;
+    const uint8_t *fp;
+    int i;
+
+    for (i = 0; i < CONFIG_CPU_IRQ_NUM; i++) {
+        fp = uld_irq_table[i].fp;
+        if (!fp) {
+            continue;
+        }
+        if ((ufile->membase && uld_irq_table[i].fb == ufile->membase) ||
+                (fp >= base && fp < base + ufile->fse->size)) {
+            printf("irq %d: released by %s\n", i, ufile->fse->name);
+            uld_irq_register(i, NULL);
+        }
+    }
+}
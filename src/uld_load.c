@@ -20,16 +20,17 @@
  * DEALINGS IN THE SOFTWARE.
 */
 
+#include <alloca.h>
+
 #include "uld.h"
 #include "uld_file.h"
 #include "uld_load.h"
+#include "uld_mem.h"
 #include "uld_rofixup.h"
 #include "uld_sal.h"
 #include "util.h"
 
 
-extern uint8_t __bss_end__;
-
 
 int uld_load_create_section(struct uld_section *section,
         const struct elf32_ehdr *ehdr, const void *base,
@@ -197,17 +198,22 @@ int uld_load_create_sec_list(const struct elf32_ehdr *ehdr,
     return sec_count;
 }
 
-uint8_t *uld_load_get_next_membase(uint8_t *last_membase, size_t last_memsize)
+size_t uld_load_get_mem_size(const struct uld_section *mem_list, int mnum)
 {
-    if (last_membase >= &__bss_end__) {
-        last_membase += last_memsize;
-    } else {
-        last_membase = &__bss_end__;
+    const struct elf32_shdr *first;
+    const struct elf32_shdr *last;
+
+    if (!mem_list || mnum <= 0) {
+        return 0;
     }
 
-    last_membase = ALIGN_PTR(last_membase, ULD_LOAD_MEMBASE_ALIGNMENT);
+    // Sections are in vma order (see uld_load_create_sec_list) and required
+    // to be in the same segment so the span includes any gaps.
+    first = mem_list[0].shdr;
+    last = mem_list[mnum - 1].shdr;
 
-    return last_membase;
+    return (ALIGN((size_t)(last->sh_addr + last->sh_size - first->sh_addr),
+            ULD_LOAD_MEMBASE_ALIGNMENT));
 }
 
 int uld_load_alloc_mem_sections(const struct elf32_ehdr *ehdr,
@@ -353,15 +359,108 @@ int uld_load_create_file(const struct uld_fs_entry *fse,
     return 0;
 }
 
-int uld_load_file(const struct uld_fs_entry *fse,
-        struct uld_section *sec_list, int snum, uint32_t type_mask,
-        uint8_t **membase, size_t *allocated, struct uld_file *ufile)
+size_t uld_load_get_fse_mem_size(const struct uld_fs_entry *fse)
 {
+    const struct elf32_ehdr *ehdr = (const struct elf32_ehdr *)fse->base;
+    struct uld_section *mem_list;
+    int mnum;
+
+    mnum = uld_load_get_sec_count(ehdr, NULL, ULD_SECTION_FLAG_TYPE_MEM);
+    if (mnum <= 0) {
+        return 0;
+    }
+
+    mem_list = alloca(sizeof(struct uld_section) * mnum);
+    mnum = uld_load_create_mem_sec_list(ehdr, NULL, mem_list, mnum);
+    if (mnum <= 0) {
+        return 0;
+    }
+
+    return uld_load_get_mem_size(mem_list, mnum);
+}
+
+// Copy the executable flash sections to RAM as one block so pc relative
+// references between them stay valid.  The flash copy is left intact, any
+// pointer not moved here still runs the same code from flash.
+static int uld_load_copy_text(struct uld_file *ufile)
+{
+    struct uld_section *sec;
+    const uint8_t *lo = (const uint8_t *)0xffffffff;
+    const uint8_t *hi = NULL;
     int ret;
+    int i;
+
+    for (i = 0; i < ufile->num.flash; i++) {
+        sec = &ufile->sec.flash[i];
+        if (sec->shdr->sh_flags & SHF_EXECINSTR) {
+            lo = MIN(lo, (const uint8_t *)sec->adjusted_lma);
+            hi = MAX(hi, (const uint8_t *)sec->adjusted_lma +
+                    sec->shdr->sh_size);
+        }
+    }
+    if (!hi) {
+        return 0;
+    }
 
-    if (!membase || !allocated ) {
+    // Keep the flash alignment for literal pool loads.
+    lo = (const uint8_t *)((uintptr_t)lo & ~((1 << ULD_MEM_ALIGNMENT) - 1));
+    ufile->text_size = ALIGN((size_t)(hi - lo), ULD_MEM_ALIGNMENT);
+    ufile->text_image = uld_mem_alloc_for(ufile->fse->name, ufile->text_size);
+    if (!ufile->text_image) {
+        printf("Error: could not allocate %d bytes of text for %s\n",
+                (int)ufile->text_size, ufile->fse->name);
+        ufile->text_size = 0;
         return -1;
     }
+    memcpy(ufile->text_image, lo, hi - lo);
+
+    for (i = 0; i < ufile->num.flash; i++) {
+        sec = &ufile->sec.flash[i];
+        if (sec->shdr->sh_flags & SHF_EXECINSTR) {
+            sec->adjusted_vma = ufile->text_image +
+                    ((const uint8_t *)sec->adjusted_lma - lo);
+        }
+    }
+
+    if (ufile->num.mem) {
+        ret = uld_rofixup_apply_ram_fixups(
+                (const struct elf32_ehdr *)ufile->fse->base, NULL,
+                ufile->sec.mem, ufile->num.mem, lo, hi - lo,
+                ufile->text_image);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    printf("%s: %d bytes of text at 0x%p\n", ufile->fse->name,
+            (int)(hi - lo), ufile->text_image);
+
+    return 0;
+}
+
+void uld_load_free_text(struct uld_file *ufile)
+{
+    if (ufile->text_image) {
+        uld_mem_free(ufile->text_image, ufile->text_size);
+        ufile->text_image = NULL;
+        ufile->text_size = 0;
+    }
+}
+
+int uld_load_file(const struct uld_fs_entry *fse,
+        struct uld_section *sec_list, int snum, uint32_t type_mask,
+        struct uld_file *ufile)
+{
+    return uld_load_file_at(fse, sec_list, snum, type_mask, NULL, ufile);
+}
+
+int uld_load_file_at(const struct uld_fs_entry *fse,
+        struct uld_section *sec_list, int snum, uint32_t type_mask,
+        uint8_t *membase, struct uld_file *ufile)
+{
+    size_t allocated;
+    size_t memsz;
+    int ret;
 
     ret = uld_load_create_file(fse, sec_list, snum, type_mask, ufile);
     if (ret) {
@@ -369,15 +468,22 @@ int uld_load_file(const struct uld_fs_entry *fse,
     }
 
     if (ufile->num.mem) {
-        ufile->membase = uld_load_get_next_membase(*membase, *allocated);
-        *membase = ufile->membase;
+        memsz = uld_load_get_mem_size(ufile->sec.mem, ufile->num.mem);
+        ufile->membase = membase ? membase :
+                uld_mem_alloc_for(fse->name, memsz);
+        if (!ufile->membase) {
+            printf("Error: could not allocate %d bytes for %s\n", (int)memsz,
+                    fse->name);
+            return -1;
+        }
+        ufile->memsz = memsz;
 
         ret = uld_load_alloc_mem_sections((const struct elf32_ehdr*)fse->base,
-                NULL, *membase, allocated, ufile->sec.mem, ufile->num.mem);
+                NULL, ufile->membase, &allocated, ufile->sec.mem,
+                ufile->num.mem);
         if (ret) {
             return ret;
         }
-        ufile->memsz = *allocated;
 
         ret = uld_rofixup_apply_mem_fixups((const struct elf32_ehdr*)fse->base,
                 NULL, ufile->sec.flash, ufile->num.flash,
@@ -388,5 +494,9 @@ int uld_load_file(const struct uld_fs_entry *fse,
         }
     }
 
+    if (fse->flags & ULD_FS_ENTRY_FLAG_RAM) {
+        ret = uld_load_copy_text(ufile);
+    }
+
     return ret;
 }
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "uld_mem.h"
+
+
+extern uint8_t _s_uld_rt;
+extern uint8_t __bss_end__;
+
+// Sorted by base, adjacent regions are always merged.
+static struct uld_mem_region uld_mem_free_list[ULD_MEM_REGION_MAX];
+static int uld_mem_free_count;
+
+
+static size_t uld_mem_align_size(size_t size)
+{
+    return (ALIGN(size, ULD_MEM_ALIGNMENT));
+}
+
+static void uld_mem_remove_region(int idx)
+{
+    uld_mem_free_count--;
+    memmove(&uld_mem_free_list[idx], &uld_mem_free_list[idx + 1],
+            sizeof(struct uld_mem_region) * (uld_mem_free_count - idx));
+}
+
+static int uld_mem_insert_region(int idx, uint8_t *base, size_t size)
+{
+    if (uld_mem_free_count == ULD_MEM_REGION_MAX) {
+        printf("uld_mem: region table full\n");
+        swbkpt();
+        return -1;
+    }
+
+    memmove(&uld_mem_free_list[idx + 1], &uld_mem_free_list[idx],
+            sizeof(struct uld_mem_region) * (uld_mem_free_count - idx));
+    uld_mem_free_list[idx].base = base;
+    uld_mem_free_list[idx].size = size;
+    uld_mem_free_count++;
+
+    return 0;
+}
+
+int uld_mem_reserve(void *ptr, size_t size)
+{
+    struct uld_mem_region *region;
+    uint8_t *start = ptr;
+    uint8_t *end;
+    uint8_t *region_end;
+    int i;
+
+    if (!ptr || !size) {
+        return -1;
+    }
+
+    end = start + uld_mem_align_size(size);
+
+    for (i = 0; i < uld_mem_free_count; i++) {
+        region = &uld_mem_free_list[i];
+        region_end = region->base + region->size;
+
+        if (start < region->base || end > region_end) {
+            continue;
+        }
+
+        if (start == region->base && end == region_end) {
+            uld_mem_remove_region(i);
+        } else if (start == region->base) {
+            region->base = end;
+            region->size = region_end - end;
+        } else if (end == region_end) {
+            region->size = start - region->base;
+        } else {
+            // Split, the upper part becomes a new region.
+            if (uld_mem_insert_region(i + 1, end, region_end - end)) {
+                return -1;
+            }
+            region->size = start - region->base;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+// Reserve the parts of [start, end) that are free.
+static void uld_mem_reserve_range(uint8_t *start, uint8_t *end)
+{
+    struct uld_mem_region *region;
+    uint8_t *lo;
+    uint8_t *hi;
+    int i;
+
+    start = (uint8_t *)((uintptr_t)start &
+            ~__ALIGN_MASK((uintptr_t)ULD_MEM_ALIGNMENT));
+    end = ALIGN_PTR(end, ULD_MEM_ALIGNMENT);
+
+    // Reserving may split or remove region i, walk down so lower indexes
+    // are not affected.
+    for (i = uld_mem_free_count - 1; i >= 0; i--) {
+        region = &uld_mem_free_list[i];
+        lo = start > region->base ? start : region->base;
+        hi = end < region->base + region->size ? end :
+                region->base + region->size;
+        if (hi > lo) {
+            uld_mem_reserve(lo, hi - lo);
+        }
+    }
+}
+
+void uld_mem_init(void)
+{
+    const struct uld_mem_bank *b;
+    uint8_t *base;
+    uint8_t *end;
+
+    uld_mem_free_count = 0;
+
+    for (b = _s_uld_mem_banks; b < _e_uld_mem_banks; b++) {
+        base = ALIGN_PTR(b->base, ULD_MEM_ALIGNMENT);
+        end = (uint8_t *)((uintptr_t)(b->base + b->size) &
+                ~__ALIGN_MASK((uintptr_t)ULD_MEM_ALIGNMENT));
+        if (end > base) {
+            uld_mem_free(base, end - base);
+        }
+    }
+
+    // Loader RAM and the stack reserve are never handed out.
+    uld_mem_reserve_range(&_s_uld_rt, &__bss_end__);
+    uld_mem_reserve_range(ESTACK - ULD_MEM_STACK_SIZE, ESTACK);
+}
+
+// Usable part of region in bank, returns the size and sets base.
+static size_t uld_mem_clip(const struct uld_mem_region *region, int bank,
+        uint8_t **base)
+{
+    const struct uld_mem_bank *b;
+    uint8_t *start = region->base;
+    uint8_t *end = region->base + region->size;
+
+    if (bank != ULD_MEM_BANK_ANY) {
+        b = &_s_uld_mem_banks[bank];
+        if (ALIGN_PTR(b->base, ULD_MEM_ALIGNMENT) > start) {
+            start = ALIGN_PTR(b->base, ULD_MEM_ALIGNMENT);
+        }
+        if (b->base + b->size < end) {
+            end = b->base + b->size;
+        }
+    }
+
+    *base = start;
+    return end > start ? (size_t)(end - start) : 0;
+}
+
+void *uld_mem_alloc_in(size_t size, int bank, uint32_t policy)
+{
+    uint8_t *ptr = NULL;
+    uint8_t *base;
+    size_t avail;
+    size_t best = 0;
+    int i;
+
+    if (!size || bank < ULD_MEM_BANK_ANY || bank >= uld_mem_get_bank_count()) {
+        return NULL;
+    }
+
+    size = uld_mem_align_size(size);
+
+    for (i = 0; i < uld_mem_free_count; i++) {
+        avail = uld_mem_clip(&uld_mem_free_list[i], bank, &base);
+        if (avail < size) {
+            continue;
+        }
+
+        // Best fit keeps the region with the least left over.
+        if (!ptr || avail < best) {
+            ptr = base;
+            best = avail;
+        }
+        if (policy != ULD_MEM_POLICY_BEST_FIT) {
+            break;
+        }
+    }
+
+    if (ptr) {
+        uld_mem_reserve(ptr, size);
+    }
+
+    return ptr;
+}
+
+void *uld_mem_alloc(size_t size)
+{
+    return uld_mem_alloc_in(size, ULD_MEM_BANK_ANY, ULD_PSTORE->mem_policy);
+}
+
+void *uld_mem_alloc_for(const char *name, size_t size)
+{
+    void *ptr;
+    int bank;
+
+    bank = uld_mem_get_place(name);
+    ptr = uld_mem_alloc_in(size, bank, ULD_PSTORE->mem_policy);
+    if (!ptr && bank != ULD_MEM_BANK_ANY) {
+        printf("uld_mem: %d bytes for %s do not fit in bank %d\n", (int)size,
+                name, bank);
+    }
+
+    return ptr;
+}
+
+int uld_mem_free(void *ptr, size_t size)
+{
+    struct uld_mem_region *prev;
+    struct uld_mem_region *next;
+    uint8_t *start = ptr;
+    uint8_t *end;
+    int i;
+
+    if (!ptr || !size) {
+        return -1;
+    }
+
+    end = start + uld_mem_align_size(size);
+
+    for (i = 0; i < uld_mem_free_count; i++) {
+        if (uld_mem_free_list[i].base >= start) {
+            break;
+        }
+    }
+
+    prev = i ? &uld_mem_free_list[i - 1] : NULL;
+    next = i < uld_mem_free_count ? &uld_mem_free_list[i] : NULL;
+
+    if ((prev && prev->base + prev->size > start) ||
+            (next && next->base < end)) {
+        printf("uld_mem: free of %p - %p overlaps free region\n", start, end);
+        swbkpt();
+        return -1;
+    }
+
+    if (prev && prev->base + prev->size == start) {
+        prev->size += end - start;
+        if (next && next->base == end) {
+            prev->size += next->size;
+            uld_mem_remove_region(i);
+        }
+    } else if (next && next->base == end) {
+        next->base = start;
+        next->size += end - start;
+    } else {
+        return uld_mem_insert_region(i, start, end - start);
+    }
+
+    return 0;
+}
+
+void *uld_mem_get_largest_in(int bank, size_t *size)
+{
+    uint8_t *largest = NULL;
+    uint8_t *base;
+    size_t largest_size = 0;
+    size_t avail;
+    int i;
+
+    if (bank >= ULD_MEM_BANK_ANY && bank < uld_mem_get_bank_count()) {
+        for (i = 0; i < uld_mem_free_count; i++) {
+            avail = uld_mem_clip(&uld_mem_free_list[i], bank, &base);
+            if (avail > largest_size) {
+                largest = base;
+                largest_size = avail;
+            }
+        }
+    }
+
+    if (size) {
+        *size = largest_size;
+    }
+
+    return largest;
+}
+
+int uld_mem_get_place(const char *name)
+{
+    const char *pos = ULD_PSTORE->mem_place;
+    const char *end = pos + ULD_PSTORE_MEM_PLACE_SIZE;
+    char entry[ULD_PSTORE_MEM_PLACE_SIZE + 1];
+    char *bank_str;
+    char *digits;
+    size_t len;
+    int bank;
+
+    while (pos < end && *pos && *pos != (char)0xff) {
+        len = 0;
+        while (pos + len < end && pos[len] && pos[len] != (char)0xff &&
+                pos[len] != ' ' && pos[len] != ',') {
+            len++;
+        }
+
+        memcpy(entry, pos, len);
+        entry[len] = '\0';
+        for (bank_str = entry; *bank_str && *bank_str != ':'; bank_str++);
+
+        if (*bank_str == ':') {
+            *bank_str++ = '\0';
+            if (!strcmp(entry, name)) {
+                digits = bank_str;
+                for (bank = 0; *bank_str >= '0' && *bank_str <= '9';
+                        bank_str++) {
+                    bank = bank * 10 + *bank_str - '0';
+                }
+                if (bank_str == digits || *bank_str ||
+                        bank >= uld_mem_get_bank_count()) {
+                    printf("uld_mem: bad bank for %s\n", name);
+                    return ULD_MEM_BANK_ANY;
+                }
+                return bank;
+            }
+        }
+
+        pos += len;
+        if (pos < end && (*pos == ' ' || *pos == ',')) {
+            pos++;
+        }
+    }
+
+    return ULD_MEM_BANK_ANY;
+}
+
+int uld_mem_find_bank(const void *ptr)
+{
+    const struct uld_mem_bank *b;
+    int i;
+
+    for (i = 0; i < uld_mem_get_bank_count(); i++) {
+        b = &_s_uld_mem_banks[i];
+        if ((const uint8_t *)ptr >= b->base &&
+                (const uint8_t *)ptr < b->base + b->size) {
+            return i;
+        }
+    }
+
+    return ULD_MEM_BANK_ANY;
+}
+
+const struct uld_mem_region *uld_mem_get_free_list(int *count)
+{
+    *count = uld_mem_free_count;
+    return uld_mem_free_list;
+}
+
+size_t uld_mem_get_free_size(void)
+{
+    size_t size = 0;
+    int i;
+
+    for (i = 0; i < uld_mem_free_count; i++) {
+        size += uld_mem_free_list[i].size;
+    }
+
+    return size;
+}
+
+size_t uld_mem_get_bank_free_size(int bank)
+{
+    uint8_t *base;
+    size_t size = 0;
+    int i;
+
+    for (i = 0; i < uld_mem_free_count; i++) {
+        size += uld_mem_clip(&uld_mem_free_list[i], bank, &base);
+    }
+
+    return size;
+}
+
+int uld_fprint_mem(FILE *stream)
+{
+    const struct uld_mem_bank *b;
+    int i;
+
+    fprintf(stream, "memory banks: %d policy: %s\n", uld_mem_get_bank_count(),
+            ULD_PSTORE->mem_policy == ULD_MEM_POLICY_BEST_FIT ?
+            "best fit" : "first fit");
+    for (i = 0; i < uld_mem_get_bank_count(); i++) {
+        b = &_s_uld_mem_banks[i];
+        fprintf(stream, "  %d: 0x%p - 0x%p %d free: %d\n", i, b->base,
+                b->base + b->size, (int)b->size,
+                (int)uld_mem_get_bank_free_size(i));
+    }
+
+    fprintf(stream, "free memory regions: %d total: %d bytes\n",
+            uld_mem_free_count, (int)uld_mem_get_free_size());
+    for (i = 0; i < uld_mem_free_count; i++) {
+        fprintf(stream, "  0x%p - 0x%p %d\n", uld_mem_free_list[i].base,
+                uld_mem_free_list[i].base + uld_mem_free_list[i].size,
+                (int)uld_mem_free_list[i].size);
+    }
+
+    return 0;
+}
@@ -20,10 +20,13 @@
  * DEALINGS IN THE SOFTWARE.
 */
 
+#include <alloca.h>
+
 #include "uld.h"
 #include "uld_dyn.h"
 #include "uld_file.h"
 #include "uld_load.h"
+#include "uld_mem.h"
 #include "uld_sal.h"
 #include "util.h"
 
@@ -33,6 +36,17 @@
 #define ULD_PRINT_MAX_FILE_NAME_LEN 26U
 
 
+struct uld_print_mem_map_entry {
+    const uint8_t *base;
+    size_t size;
+    const char *name;
+    const char *use;
+};
+
+extern uint8_t _s_uld_rt;
+extern uint8_t __bss_end__;
+
+
 const char uld_print_section_header_str[] =
     " &shdr       shidx name                 "
     "lma      adj_lma  fileoff  faddr\n"
@@ -48,7 +62,7 @@ int uld_fprint_fse_file(FILE *stream, const struct uld_file *ufile)
 
     fprintf(stream, "[<%p>] %-26s %p %08x %08lx %08lx\n\n", ufile->fse->base,
             ufile->fse->name, ufile->fse->base, ufile->fse->size,
-            ufile->fse->crc, ufile->fse->flags);
+            (unsigned long)ufile->fse->crc, (unsigned long)ufile->fse->flags);
 
     return 0;
 }
@@ -66,7 +80,8 @@ int uld_fprint_section(FILE *stream, const struct uld_section *section)
     fprintf(stream, "               %2d                       "
             "%p %p %08lx %08lx\n", section->phidx,
             (void *)section->shdr->sh_addr, section->adjusted_vma,
-            section->shdr->sh_size, section->flags);
+            (unsigned long)section->shdr->sh_size,
+            (unsigned long)section->flags);
 
     return 0;
 }
@@ -309,8 +324,8 @@ int uld_fprint_dyn(FILE *stream, const struct uld_file *ufile, int all)
             }
         }
         if (type_ptr) {
-            fprintf(stream, "[<%p>]  %08lx  (%-20s %s\n", dyn, dyn->d_tag,
-                    type_ptr, val_ptr);
+            fprintf(stream, "[<%p>]  %08lx  (%-20s %s\n", dyn,
+                    (unsigned long)dyn->d_tag, type_ptr, val_ptr);
         }
     }
 
@@ -412,8 +427,8 @@ int uld_fprint_dynsym(FILE *stream, const struct uld_file *ufile)
         }
 
         fprintf(stream, "%5d: %08lx %5d %-7s %-6s %-8s %3s %s\n",
-                idx, sym->st_value, (int)sym->st_size, type_ptr, bind_ptr,
-                vis_ptr, ndx_ptr,
+                idx, (unsigned long)sym->st_value, (int)sym->st_size,
+                type_ptr, bind_ptr, vis_ptr, ndx_ptr,
                 uld_dyn_get_sym_name(sym, dynstr_sec));
     }
 
@@ -510,8 +525,8 @@ int uld_fprint_rel_dyn(FILE *stream, const struct uld_file *ufile)
         }
 
         fprintf(stream, "[<%p>] %08lx %-17s %s (%s)\n", rel,
-                rel->r_info, type_ptr, uld_dyn_get_sym_name(sym, dynstr_sec),
-                sym_sec_name);
+                (unsigned long)rel->r_info, type_ptr,
+                uld_dyn_get_sym_name(sym, dynstr_sec), sym_sec_name);
 
 
         section = uld_section_find_in_lists_by_lma(ufile->sec.s, ufile->num.n,
@@ -537,8 +552,109 @@ int uld_fprint_rel_dyn(FILE *stream, const struct uld_file *ufile)
         }
         off_val = off_vma ? *off_vma : 0;
 
-        fprintf(stream, "             %08lx %p %08lx %s\n", rel->r_offset,
-                off_vma, off_val, section ? section->name : "UNKNOWN");
+        fprintf(stream, "             %08lx %p %08lx %s\n",
+                (unsigned long)rel->r_offset, off_vma, (unsigned long)off_val,
+                section ? section->name : "UNKNOWN");
+    }
+
+    return 0;
+}
+
+static void uld_print_mem_map_add(struct uld_print_mem_map_entry *map,
+        int *count, const void *base, size_t size, const char *name,
+        const char *use)
+{
+    int i;
+
+    if (!base || !size) {
+        return;
+    }
+
+    // Insertion sort by base.
+    for (i = *count; i > 0 && map[i - 1].base > (const uint8_t *)base; i--) {
+        map[i] = map[i - 1];
+    }
+    map[i].base = base;
+    map[i].size = size;
+    map[i].name = name;
+    map[i].use = use;
+    (*count)++;
+}
+
+int uld_fprint_mem_map(FILE *stream)
+{
+    const struct uld_dyn_state *ds = &uld_dyn_state;
+    const struct uld_file *ufile;
+    const struct uld_mem_region *free_list;
+    const struct uld_mem_bank *b;
+    struct uld_print_mem_map_entry *map;
+    int free_count;
+    int count = 0;
+    int bank;
+    int i;
+
+    if (!stream) {
+        return -1;
+    }
+
+    free_list = uld_mem_get_free_list(&free_count);
+    map = alloca(sizeof(struct uld_print_mem_map_entry) *
+            (3 + ds->file_count * 5 + ULD_DYN_OVERLAY_MAX + free_count));
+
+    uld_print_mem_map_add(map, &count, &_s_uld_rt,
+            &__bss_end__ - &_s_uld_rt, "uld", "loader");
+    // A declared stack below ESTACK covers the loader's stack reserve.
+    if (!ds->stack_size || ds->stack_base + ds->stack_size != ESTACK ||
+            ds->stack_size < ULD_MEM_STACK_SIZE) {
+        uld_print_mem_map_add(map, &count, ESTACK - ULD_MEM_STACK_SIZE,
+                ULD_MEM_STACK_SIZE, "uld", "stack");
+    }
+    if (ds->stack_size) {
+        uld_print_mem_map_add(map, &count, ds->stack_base, ds->stack_size,
+                ds->ufile_list[ds->exec_idx].fse->name, "stack");
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        if (!(ufile->flags & ULD_FILE_FLAG_OVERLAY)) {
+            uld_print_mem_map_add(map, &count, ufile->membase, ufile->memsz,
+                    ufile->fse->name, "mem");
+        }
+        uld_print_mem_map_add(map, &count, ufile->text_image,
+                ufile->text_size, ufile->fse->name, "text");
+        uld_print_mem_map_add(map, &count, ufile->data_image,
+                uld_file_get_data_size(ufile), ufile->fse->name, "data image");
+        uld_print_mem_map_add(map, &count, ufile->dl_alloc_base,
+                ufile->dl_alloc_size, ufile->fse->name, "dl_alloc");
+        uld_print_mem_map_add(map, &count, ufile->heap_base,
+                ufile->heap_size, ufile->fse->name, "heap");
+    }
+
+    for (i = 0; i < ULD_DYN_OVERLAY_MAX; i++) {
+        uld_print_mem_map_add(map, &count, ds->overlay[i].base,
+                ds->overlay[i].size, ds->overlay[i].active ?
+                ds->overlay[i].active->name : "-", "overlay");
+    }
+
+    for (i = 0; i < free_count; i++) {
+        uld_print_mem_map_add(map, &count, free_list[i].base,
+                free_list[i].size, "-", "free");
+    }
+
+    fprintf(stream, "memory map:\n");
+    for (bank = 0; bank < uld_mem_get_bank_count(); bank++) {
+        b = &_s_uld_mem_banks[bank];
+        fprintf(stream, "bank %d: 0x%p - 0x%p %d free: %d\n", bank, b->base,
+                b->base + b->size, (int)b->size,
+                (int)uld_mem_get_bank_free_size(bank));
+        for (i = 0; i < count; i++) {
+            if (uld_mem_find_bank(map[i].base) != bank) {
+                continue;
+            }
+            fprintf(stream, "  0x%p - 0x%p %6d %-10s %s\n", map[i].base,
+                    map[i].base + map[i].size, (int)map[i].size, map[i].use,
+                    map[i].name);
+        }
     }
 
     return 0;
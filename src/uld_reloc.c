@@ -20,9 +20,14 @@
  * DEALINGS IN THE SOFTWARE.
 */
 
+#include <alloca.h>
+
 #include "uld.h"
 #include "cpu.h"
+#include "uld_file.h"
+#include "uld_fs.h"
 #include "uld_load.h"
+#include "uld_reloc.h"
 #include "uld_rofixup.h"
 #include "uld_sal.h"
 #include "util.h"
@@ -35,6 +40,11 @@ static const char * const uld_reloc_flash_fixup_mem_sections[] = {
 };
 
 
+// Set once an importer is linked to a flash descriptor, the fdtab area can
+// not be erased after that.
+static int uld_reloc_fdtab_used;
+
+
 static int uld_reloc_prepare_flash_fixups(struct uld_file *ufile) {
     int i;
 
@@ -62,10 +72,581 @@ static int uld_reloc_prepare_flash_fixups(struct uld_file *ufile) {
     return 0;
 }
 
+static size_t uld_reloc_get_fdtab_size(const struct uld_reloc_fdtab *fdtab)
+{
+    return sizeof(struct uld_reloc_fdtab) +
+            fdtab->count * sizeof(struct uld_dyn_funcdesc);
+}
+
+// Table following fdtab (first table if fdtab is NULL) or NULL at the end of
+// the written part of the fdtab area.
+static const struct uld_reloc_fdtab *uld_reloc_next_fdtab(
+        const struct uld_reloc_fdtab *fdtab)
+{
+    const uint8_t *end = ULD_RELOC_FDTAB_BASE + ULD_RELOC_FDTAB_SIZE;
+    const uint8_t *next;
+
+    if (fdtab) {
+        next = (const uint8_t *)fdtab + uld_reloc_get_fdtab_size(fdtab);
+    } else {
+        next = ULD_RELOC_FDTAB_BASE;
+    }
+
+    if (next + sizeof(struct uld_reloc_fdtab) > end) {
+        return NULL;
+    }
+
+    fdtab = (const struct uld_reloc_fdtab *)next;
+    if ((fdtab->magic != ULD_RELOC_FDTAB_MAGIC &&
+            fdtab->magic != ULD_RELOC_STAMP_MAGIC) ||
+            next + uld_reloc_get_fdtab_size(fdtab) > end) {
+        return NULL;
+    }
+
+    return fdtab;
+}
+
+const struct uld_reloc_fdtab *uld_reloc_find_fdtab(
+        const struct uld_fs_entry *fse)
+{
+    const struct uld_reloc_fdtab *fdtab = NULL;
+    const struct uld_reloc_fdtab *pos;
+
+    for (pos = uld_reloc_next_fdtab(NULL); pos;
+            pos = uld_reloc_next_fdtab(pos)) {
+        if (pos->fse == fse && pos->magic == ULD_RELOC_FDTAB_MAGIC) {
+            fdtab = pos;
+        }
+    }
+
+    return fdtab;
+}
+
+// Tables are only kept for files with a fixed flash address and membase,
+// RAM text and overlay windows can move between boots.
+static int uld_reloc_has_fdtab(const struct uld_file *ufile)
+{
+    return (ufile->fse->flags & ULD_FS_ENTRY_FLAG_FDTAB) &&
+            !ufile->text_image && !(ufile->flags & ULD_FILE_FLAG_OVERLAY);
+}
+
+const struct uld_reloc_fdtab *uld_reloc_get_fdtab(
+        const struct uld_file *ufile)
+{
+    const struct uld_reloc_fdtab *fdtab;
+
+    if (!ufile || !uld_reloc_has_fdtab(ufile)) {
+        return NULL;
+    }
+
+    fdtab = uld_reloc_find_fdtab(ufile->fse);
+    if (!fdtab || fdtab->file_base != ufile->fse->base ||
+            fdtab->membase != ufile->membase ||
+            fdtab->crc != ufile->fse->crc) {
+        return NULL;
+    }
+
+    return fdtab;
+}
+
+const struct uld_dyn_funcdesc *uld_reloc_get_fdtab_funcdesc(
+        const struct uld_file *ufile, const void *fp)
+{
+    const struct uld_reloc_fdtab *fdtab;
+    const struct uld_dyn_funcdesc *fd;
+    uint32_t i;
+
+    fdtab = uld_reloc_get_fdtab(ufile);
+    if (!fdtab || !fp) {
+        return NULL;
+    }
+
+    fd = (const struct uld_dyn_funcdesc *)(fdtab + 1);
+    for (i = 0; i < fdtab->count; i++) {
+        if (fd[i].fp == fp) {
+            uld_reloc_fdtab_used = 1;
+            return &fd[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Append a table or stamp, flash must be unlocked.  A full area is erased
+// unless an importer already points into it, tables and stamps of other
+// files are then written again the next time they are loaded.
+static int uld_reloc_write_fdtab(const struct uld_reloc_fdtab *hdr,
+        const struct uld_dyn_funcdesc *fd)
+{
+    const struct uld_reloc_fdtab *pos;
+    uint8_t *dest = ULD_RELOC_FDTAB_BASE;
+    size_t size = uld_reloc_get_fdtab_size(hdr);
+    int ret;
+
+    for (pos = uld_reloc_next_fdtab(NULL); pos;
+            pos = uld_reloc_next_fdtab(pos)) {
+        dest = (uint8_t *)pos + uld_reloc_get_fdtab_size(pos);
+    }
+
+    if (dest + size > ULD_RELOC_FDTAB_BASE + ULD_RELOC_FDTAB_SIZE) {
+        if (uld_reloc_fdtab_used || size > ULD_RELOC_FDTAB_SIZE) {
+            printf("fdtab: no space for %s\n", hdr->fse->name);
+            return -1;
+        }
+        dest = ULD_RELOC_FDTAB_BASE;
+        ret = cpu_flash_erase(dest, ULD_RELOC_FDTAB_SIZE);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    // Header is written last so an interrupted write is never valid.
+    ret = 0;
+    if (hdr->count) {
+        ret = cpu_flash_write(dest + sizeof(struct uld_reloc_fdtab), fd,
+                size - sizeof(struct uld_reloc_fdtab));
+    }
+    if (!ret) {
+        ret = cpu_flash_write(dest, hdr, sizeof(struct uld_reloc_fdtab));
+    }
+
+    if (!ret && hdr->magic == ULD_RELOC_FDTAB_MAGIC) {
+        printf("fdtab: %-16s %d descriptors at 0x%p membase: 0x%p\n",
+                hdr->fse->name, (int)hdr->count, dest, hdr->membase);
+    }
+
+    return ret;
+}
+
+// Build the table of loaded ufile from the functions it exports.
+static int uld_reloc_build_fdtab(const struct uld_file *ufile)
+{
+    const struct uld_section *dynsym_sec;
+    const struct elf32_sym *sym;
+    struct uld_reloc_fdtab hdr;
+    struct uld_dyn_funcdesc *fd;
+    int sym_count;
+    int i;
+
+    dynsym_sec = uld_file_get_sec_dynsym(ufile);
+    if (!dynsym_sec) {
+        return -1;
+    }
+
+    sym = (const struct elf32_sym *)dynsym_sec->adjusted_lma;
+    sym_count = dynsym_sec->shdr->sh_size / sizeof(struct elf32_sym);
+    fd = alloca(sizeof(struct uld_dyn_funcdesc) * sym_count);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ULD_RELOC_FDTAB_MAGIC;
+    hdr.fse = ufile->fse;
+    hdr.file_base = ufile->fse->base;
+    hdr.membase = ufile->membase;
+    hdr.crc = ufile->fse->crc;
+
+    for (i = 0; i < sym_count; i++, sym++) {
+        if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC ||
+                ELF32_ST_BIND(sym->st_info) == STB_LOCAL ||
+                !elf32_sym_has_section_index(sym)) {
+            continue;
+        }
+        fd[hdr.count].fp = uld_file_lma_to_adjusted_vma(ufile,
+                (void *)sym->st_value);
+        fd[hdr.count].fb = ufile->membase;
+        if (fd[hdr.count].fp) {
+            hdr.count++;
+        }
+    }
+
+    return uld_reloc_write_fdtab(&hdr, fd);
+}
+
+int uld_reloc_update_fdtab(const struct uld_file *ufile_list, int file_count)
+{
+    const struct uld_file *ufile;
+    int was_locked = -1;
+    int ret = 0;
+    int i;
+
+    if (!ufile_list || file_count < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < file_count && !ret; i++) {
+        ufile = &ufile_list[i];
+        if (!uld_reloc_has_fdtab(ufile) || uld_reloc_get_fdtab(ufile)) {
+            continue;
+        }
+
+        if (was_locked < 0) {
+            was_locked = cpu_flash_is_locked();
+            if (was_locked) {
+                cpu_flash_unlock();
+            }
+        }
+
+        ret = uld_reloc_build_fdtab(ufile);
+    }
+
+    if (was_locked > 0) {
+        cpu_flash_lock();
+    }
+
+    return ret;
+}
+
+int uld_reloc_check_stamp(const struct uld_fs_entry *fse, uint32_t stamp)
+{
+    const struct uld_reloc_fdtab *found = NULL;
+    const struct uld_reloc_fdtab *pos;
+
+    for (pos = uld_reloc_next_fdtab(NULL); pos;
+            pos = uld_reloc_next_fdtab(pos)) {
+        if (pos->fse == fse && pos->magic == ULD_RELOC_STAMP_MAGIC) {
+            found = pos;
+        }
+    }
+
+    if (!found || found->file_base != fse->base || found->stamp != stamp) {
+        return 0;
+    }
+
+    // Flash relocations bound with the stamp may point to descriptors.
+    uld_reloc_fdtab_used = 1;
+
+    return 1;
+}
+
+int uld_reloc_set_stamp(const struct uld_fs_entry *fse, uint32_t stamp)
+{
+    struct uld_reloc_fdtab hdr;
+    int was_locked;
+    int ret;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ULD_RELOC_STAMP_MAGIC;
+    hdr.fse = fse;
+    hdr.file_base = fse->base;
+    hdr.stamp = stamp;
+
+    was_locked = cpu_flash_is_locked();
+    if (was_locked) {
+        cpu_flash_unlock();
+    }
+
+    ret = uld_reloc_write_fdtab(&hdr, NULL);
+
+    if (was_locked) {
+        cpu_flash_lock();
+    }
+
+    return ret;
+}
+
+#ifdef ULD_PLT_VENEER
+// PLT entry as generated by ld (see patch_plt_gotofffuncdesc in
+// patch-uld-elf.py) followed by the GOTOFFFUNCDESC of its .got.plt slot:
+//   ldr.w ip, [pc, #12]
+//   add ip, ip, r9
+//   ldr.w r9, [ip, #4]
+//   ldr.w pc, [ip]
+static const uint32_t uld_reloc_plt_entry[] = {
+    0xc00cf8df,
+    0x0c09eb0c,
+    0x9004f8dc,
+    0xf000f8dc
+};
+
+// Direct veneer followed by the GOTOFFFUNCDESC (kept to restore the entry),
+// the fdpic base and the address of the target:
+//   ldr.w r9, [pc, #8]
+//   ldr.w pc, [pc, #8]
+static const uint32_t uld_reloc_plt_veneer[] = {
+    0x9008f8df,
+    0xf008f8df
+};
+
+#define ULD_RELOC_PLT_ENTRY_WORDS                   5
+#define ULD_RELOC_PLT_GOTOFF_IDX                    4
+#define ULD_RELOC_PLT_VENEER_GOTOFF_IDX             2
+#define ULD_RELOC_PLT_VENEER_FB_IDX                 3
+#define ULD_RELOC_PLT_VENEER_FP_IDX                 4
+
+
+static int uld_reloc_match_words(const uint32_t *a, const uint32_t *b,
+        int count)
+{
+    while (count--) {
+        if (*a++ != *b++) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Returns the GOTOFFFUNCDESC of a PLT entry or veneer, -1 for any other
+// layout.
+static int32_t uld_reloc_get_plt_gotoff(const uint32_t *entry)
+{
+    if (uld_reloc_match_words(entry, uld_reloc_plt_veneer,
+            sizeof(uld_reloc_plt_veneer) / sizeof(uint32_t))) {
+        return entry[ULD_RELOC_PLT_VENEER_GOTOFF_IDX];
+    }
+
+    if (uld_reloc_match_words(entry, uld_reloc_plt_entry,
+            sizeof(uld_reloc_plt_entry) / sizeof(uint32_t))) {
+        return entry[ULD_RELOC_PLT_GOTOFF_IDX];
+    }
+
+    return -1;
+}
+
+// A veneer may only be used for a provider of the same instance with a
+// valid descriptor table, its flash address and membase are then fixed.
+static int uld_reloc_can_use_veneer(const struct uld_file *ufile_list,
+        int file_count, const struct uld_file *ufile,
+        const struct uld_dyn_funcdesc *slot)
+{
+    const struct uld_file *res;
+    const uint8_t *fp = slot->fp;
+    int i;
+
+    for (i = 0; i < file_count; i++) {
+        res = &ufile_list[i];
+        if (res->instance != ufile->instance ||
+                (const void *)res->membase != slot->fb) {
+            continue;
+        }
+
+        return uld_reloc_get_fdtab(res) &&
+                fp >= (const uint8_t *)res->fse->base &&
+                fp < (const uint8_t *)res->fse->base + res->fse->size;
+    }
+
+    return 0;
+}
+
+// Rewrite the PLT entries of loaded ufile to veneers where the current
+// .got.plt slot allows it and back to PLT entries otherwise.  Flash must be
+// unlocked.  Returns the number of entries written or -1.
+static int uld_reloc_update_file_plt(const struct uld_file *ufile_list,
+        int file_count, const struct uld_file *ufile, int allow_veneer)
+{
+    const struct uld_section *plt_sec;
+    const struct uld_dyn_funcdesc *slot;
+    uint32_t new_entry[ULD_RELOC_PLT_ENTRY_WORDS];
+    const uint32_t *entry;
+    const uint32_t *end;
+    int32_t gotoff;
+    int count = 0;
+
+    plt_sec = uld_file_get_sec_plt(ufile);
+    if (!plt_sec) {
+        return 0;
+    }
+
+    entry = plt_sec->adjusted_lma;
+    end = entry + plt_sec->shdr->sh_size / sizeof(uint32_t);
+    for (; entry + ULD_RELOC_PLT_ENTRY_WORDS <= end;
+            entry += ULD_RELOC_PLT_ENTRY_WORDS) {
+        gotoff = uld_reloc_get_plt_gotoff(entry);
+        if (gotoff < 0 ||
+                gotoff + sizeof(struct uld_dyn_funcdesc) > ufile->memsz) {
+            continue;
+        }
+
+        slot = (const struct uld_dyn_funcdesc *)(ufile->membase + gotoff);
+        if (allow_veneer && uld_reloc_can_use_veneer(ufile_list, file_count,
+                ufile, slot)) {
+            memcpy(new_entry, uld_reloc_plt_veneer,
+                    sizeof(uld_reloc_plt_veneer));
+            new_entry[ULD_RELOC_PLT_VENEER_GOTOFF_IDX] = gotoff;
+            new_entry[ULD_RELOC_PLT_VENEER_FB_IDX] = (uint32_t)slot->fb;
+            new_entry[ULD_RELOC_PLT_VENEER_FP_IDX] = (uint32_t)slot->fp;
+        } else {
+            memcpy(new_entry, uld_reloc_plt_entry,
+                    sizeof(uld_reloc_plt_entry));
+            new_entry[ULD_RELOC_PLT_GOTOFF_IDX] = gotoff;
+        }
+
+        if (uld_reloc_match_words(entry, new_entry,
+                ULD_RELOC_PLT_ENTRY_WORDS)) {
+            continue;
+        }
+
+        if (cpu_flash_write((void *)entry, new_entry, sizeof(new_entry))) {
+            return -1;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+int uld_reloc_update_plt(const struct uld_file *ufile_list, int file_count)
+{
+    const struct uld_file *ufile;
+    int allow_veneer;
+    int was_locked;
+    int written = 0;
+    int count;
+    int ret = 0;
+    int i;
+    int j;
+
+    if (!ufile_list || file_count < 0) {
+        return -1;
+    }
+
+    was_locked = cpu_flash_is_locked();
+    if (was_locked) {
+        cpu_flash_unlock();
+    }
+
+    for (i = 0; i < file_count; i++) {
+        ufile = &ufile_list[i];
+        // The PLT of a RAM copy is not in flash.
+        if (ufile->text_image) {
+            continue;
+        }
+
+        // Entries are shared by every loaded copy of the file.
+        allow_veneer = 1;
+        for (j = 0; j < file_count; j++) {
+            if (j != i && ufile_list[j].fse == ufile->fse) {
+                allow_veneer = 0;
+            }
+        }
+
+        count = uld_reloc_update_file_plt(ufile_list, file_count, ufile,
+                allow_veneer);
+        if (count < 0) {
+            ret = -1;
+            break;
+        }
+
+        if (count) {
+            printf("plt: %-16s %d entries rewritten\n", ufile->fse->name,
+                    count);
+            uld_crc_update_fse((struct uld_fs_entry *)ufile->fse, NULL);
+            written += count;
+        }
+    }
+
+    if (written) {
+        uld_crc_update_fst(NULL);
+    }
+
+    if (was_locked) {
+        cpu_flash_lock();
+    }
+
+    return ret;
+}
+
+// Point veneers to functions of a moved fse at its new flash address.
+// Flash must be unlocked.
+static int uld_reloc_rebase_plt(const struct uld_fs_entry *fse,
+        const void *old_base, struct uld_section *sec_list, int snum)
+{
+    const uint8_t *old_end = (const uint8_t *)old_base + fse->size;
+    const struct uld_fs_entry *pos;
+    const struct uld_section *plt_sec;
+    struct uld_file ufile;
+    const uint32_t *entry;
+    const uint32_t *end;
+    const uint8_t *fp;
+    int written = 0;
+    int count;
+
+    fst_for_each_entry(pos, uld_fs_get_fst_head()) {
+        if (uld_load_create_file(pos, sec_list, snum,
+                ULD_SECTION_FLAG_TYPE_ALL, &ufile)) {
+            continue;
+        }
+
+        plt_sec = uld_file_get_sec_plt(&ufile);
+        if (!plt_sec) {
+            continue;
+        }
+
+        count = 0;
+        entry = plt_sec->adjusted_lma;
+        end = entry + plt_sec->shdr->sh_size / sizeof(uint32_t);
+        for (; entry + ULD_RELOC_PLT_ENTRY_WORDS <= end;
+                entry += ULD_RELOC_PLT_ENTRY_WORDS) {
+            fp = (const uint8_t *)entry[ULD_RELOC_PLT_VENEER_FP_IDX];
+            if (!uld_reloc_match_words(entry, uld_reloc_plt_veneer,
+                    sizeof(uld_reloc_plt_veneer) / sizeof(uint32_t)) ||
+                    fp < (const uint8_t *)old_base || fp >= old_end) {
+                continue;
+            }
+
+            fp = (const uint8_t *)fse->base +
+                    (fp - (const uint8_t *)old_base);
+            if (cpu_flash_write((void *)&entry[ULD_RELOC_PLT_VENEER_FP_IDX],
+                    &fp, sizeof(fp))) {
+                return -1;
+            }
+            count++;
+        }
+
+        if (count) {
+            uld_crc_update_fse((struct uld_fs_entry *)pos, NULL);
+            written += count;
+        }
+    }
+
+    if (written) {
+        uld_crc_update_fst(NULL);
+    }
+
+    return 0;
+}
+#endif  // ULD_PLT_VENEER
+
+// Write a copy of the table of a moved fse for its new flash address.
+// Descriptors of flash functions follow the file, the membase plan and
+// functions in RAM are unchanged.  Flash must be unlocked.
+static int uld_reloc_rebase_fdtab(const struct uld_fs_entry *fse,
+        const void *old_base)
+{
+    const struct uld_reloc_fdtab *fdtab;
+    const uint8_t *old_end = (const uint8_t *)old_base + fse->size;
+    struct uld_reloc_fdtab hdr;
+    struct uld_dyn_funcdesc *fd;
+    uint32_t i;
+
+    fdtab = uld_reloc_find_fdtab(fse);
+    if (!fdtab || fdtab->file_base != old_base) {
+        return 0;
+    }
+
+    // The area may be erased by the write, copy the old table first.  The
+    // crc of the moved file was already updated for its new address.
+    hdr = *fdtab;
+    hdr.file_base = fse->base;
+    hdr.crc = fse->crc;
+    fd = alloca(sizeof(struct uld_dyn_funcdesc) * hdr.count);
+    memcpy(fd, fdtab + 1, sizeof(struct uld_dyn_funcdesc) * hdr.count);
+
+    for (i = 0; i < hdr.count; i++) {
+        if ((const uint8_t *)fd[i].fp >= (const uint8_t *)old_base &&
+                (const uint8_t *)fd[i].fp < old_end) {
+            fd[i].fp = (const uint8_t *)fse->base +
+                    ((const uint8_t *)fd[i].fp - (const uint8_t *)old_base);
+        }
+    }
+
+    return uld_reloc_write_fdtab(&hdr, fd);
+}
+
 int uld_reloc_move_fse(const struct uld_fs_entry *fse, const void *new_base)
 {
     struct uld_section sec_list[ULD_FILE_SECTION_MAX];
     struct uld_file ufile;
+    const void *old_base;
     const void *new_end;
     const void *fse_end;
     int was_locked = 0;
@@ -119,6 +700,7 @@ int uld_reloc_move_fse(const struct uld_fs_entry *fse, const void *new_base)
         goto done;
     }
 
+    old_base = fse->base;
     ret = cpu_flash_write((void *)&fse->base, &new_base, sizeof(void *));
     if (ret) {
         goto done;
@@ -127,6 +709,14 @@ int uld_reloc_move_fse(const struct uld_fs_entry *fse, const void *new_base)
     uld_crc_update_fse((struct uld_fs_entry *)fse, NULL);
     uld_crc_update_fst(NULL);
 
+    ret = uld_reloc_rebase_fdtab(fse, old_base);
+#ifdef ULD_PLT_VENEER
+    if (!ret) {
+        ret = uld_reloc_rebase_plt(fse, old_base, sec_list,
+                sizeof(sec_list) / sizeof(struct uld_section));
+    }
+#endif
+
 done:
     if (was_locked) {
         cpu_flash_unlock();
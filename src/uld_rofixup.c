@@ -44,6 +44,12 @@ struct do_mem_fixup_userdata {
     int mnum;
 };
 
+struct do_ram_fixup_userdata {
+    const uint8_t *from;
+    size_t size;
+    uint8_t *to;
+};
+
 struct do_fixup_data {
     uint8_t **fixup_addr;
     struct uld_section *fixup_sec;
@@ -260,6 +266,27 @@ static int uld_rofixup_do_mem_fixup(struct do_fixup_data *dfd)
     return 0;
 }
 
+static int uld_rofixup_do_ram_fixup(struct do_fixup_data *dfd)
+{
+    struct do_ram_fixup_userdata *ud = dfd->userdata;
+
+    dfd->adj_fixup_addr = (uint8_t **)(*dfd->fixup_addr -
+            (uintptr_t)dfd->fixup_sec->lma +
+            (uintptr_t)dfd->fixup_sec->adjusted_vma);
+
+    // Only pointers into the copied range are moved, everything else
+    // (including blank entries) was finished by the mem fixups.
+    if (*dfd->adj_fixup_addr < ud->from ||
+            *dfd->adj_fixup_addr >= ud->from + ud->size) {
+        return 1;
+    }
+
+    dfd->new_adj_fixup_addr = *dfd->adj_fixup_addr - (uintptr_t)ud->from +
+            (uintptr_t)ud->to;
+
+    return 0;
+}
+
 int uld_rofixup_apply_flash_fixups(const struct elf32_ehdr *ehdr,
         const void *base, struct uld_section *flash_list, int fnum,
         struct uld_section *mem_list, int mnum)
@@ -347,3 +374,34 @@ int uld_rofixup_apply_mem_fixups(const struct elf32_ehdr *ehdr,
 
     return ret;
 }
+
+int uld_rofixup_apply_ram_fixups(const struct elf32_ehdr *ehdr,
+        const void *base, struct uld_section *mem_list, int mnum,
+        const void *from, size_t size, void *to)
+{
+    struct do_ram_fixup_userdata ud = {
+        .from = from,
+        .size = size,
+        .to = to
+    };
+
+    if (!ehdr || mnum < 0 || (mnum && !mem_list) || !from || !to) {
+        return -1;
+    }
+
+    if (!mnum) {
+        return 1;
+    }
+
+    if (uld_verbose) {
+        puts("Applying ram fixups:");
+        puts("  fixup_ptr      fixup_val      fixup_vma      fixup_tgt_adj  "
+                "fixup_tgt_ram");
+    }
+
+    // Mem sections must have had their mem fixups applied (done flag set).
+    return uld_rofixup_apply_fixups(ehdr, base, mem_list, mnum,
+            ULD_SECTION_FLAG_STATUS_MEM_FIXUP_DONE,
+            ULD_SECTION_FLAG_STATUS_MEM_FIXUP_DONE,
+            uld_rofixup_do_ram_fixup, &ud);
+}
@@ -35,6 +35,7 @@ const char * const uld_section_mem_name_list[
     ".got",         // mem/flash rofixup
     ".got.plt",     // mem rofixup
     ".data",        // flash rofixup
+    ".ramfunc",
     ".bss",
 };
 
@@ -60,7 +61,7 @@ int uld_crc_update_fst(uint32_t *crc)
     if (crc) {
         *crc = c;
     }
-    printf("Updating fst crc: 0x%08lx\n", c);
+    printf("Updating fst crc: 0x%08lx\n", (unsigned long)c);
     return cpu_flash_write(&ULD_PSTORE->fs_table_pri.crc, &c,
             sizeof(uint32_t));
 }
@@ -85,10 +86,21 @@ int uld_crc_update_fse(struct uld_fs_entry *fse, uint32_t *crc)
     if (crc) {
         *crc = c;
     }
-    printf("Updating fse crc: 0x%08lx\n", c);
+    printf("Updating fse crc: 0x%08lx\n", (unsigned long)c);
     return cpu_flash_write(&fse->crc, &c, sizeof(uint32_t));
 }
 
+uint32_t uld_crc_calc_pstore(void)
+{
+    const struct uld_pstore *pstore = ULD_PSTORE;
+    uint32_t crc;
+
+    crc = crc32(pstore->preload, sizeof(pstore->preload), UTIL_CRC32_INIT);
+    crc = crc32(&pstore->mem_policy, sizeof(pstore->mem_policy), crc);
+
+    return crc32(pstore->mem_place, sizeof(pstore->mem_place), crc);
+}
+
 uint32_t uld_section_get_type(const struct elf32_shdr *shdr, const char *name)
 {
     if (shdr->sh_flags & SHF_ALLOC) {
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_dyn.h"
+#include "uld_sched.h"
+
+
+// Hardware exception frame (ARM DDI0403E B1.5.6) below the software frame
+// saved by uld_sched_pendsv.
+struct uld_sched_frame {
+    uint32_t r3;
+    uint32_t r4;
+    uint32_t r5;
+    uint32_t r6;
+    uint32_t r7;
+    uint32_t r8;
+    uint32_t r9;
+    uint32_t r10;
+    uint32_t r11;
+    uint32_t exc_return;
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t hw_r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t xpsr;
+};
+
+static struct uld_sched_task uld_sched_task_list[ULD_SCHED_TASK_MAX];
+static uint32_t *uld_sched_idle_sp;
+static int uld_sched_cur = -1;
+static volatile int uld_sched_ready_count;
+static volatile int uld_sched_lock_count;
+
+
+static void uld_sched_pend_switch(void)
+{
+    *(volatile uint32_t *)ARM_CORTEX_M_ICSR_ADDR =
+            ARM_CORTEX_M_ICSR_PENDSVSET;
+}
+
+void uld_sched_init(void)
+{
+    // Switches must not preempt other exception handlers (including loader
+    // services).
+    *(volatile uint32_t *)ARM_CORTEX_M_SHPR3_ADDR |=
+            ARM_CORTEX_M_SHPR3_PENDSV_SYSTICK_LOWEST;
+#ifdef CONFIG_CPU_VEC_IN_MEM
+    cpu_memvec_set(ARM_CORTEX_M_EXC_PENDSV, uld_sched_pendsv);
+    cpu_memvec_set(ARM_CORTEX_M_EXC_SYSTICK, uld_sched_systick);
+#endif
+}
+
+int uld_sched_add_task(const void *entry, uint32_t fdpic_base, int instance,
+        uint8_t *stack_base, size_t stack_size, int argc, const char **argv)
+{
+    struct uld_sched_task *task = NULL;
+    struct uld_sched_frame *frame;
+    int i;
+
+    if (!entry || !stack_base || stack_size < sizeof(*frame)) {
+        return -1;
+    }
+
+    for (i = 0; i < ULD_SCHED_TASK_MAX; i++) {
+        if (uld_sched_task_list[i].state == ULD_SCHED_TASK_STATE_FREE) {
+            task = &uld_sched_task_list[i];
+            break;
+        }
+    }
+    if (!task) {
+        printf("sched: task table full\n");
+        return -1;
+    }
+
+    // Frame size is a multiple of 8, the top is aligned down.
+    frame = (struct uld_sched_frame *)(((uintptr_t)(stack_base +
+            stack_size) & ~0x7) - sizeof(*frame));
+    memset(frame, 0, sizeof(*frame));
+    frame->r9 = fdpic_base;
+    frame->exc_return = ARM_CORTEX_M_EXC_RETURN_THREAD_PSP;
+    frame->r0 = argc;
+    frame->r1 = (uint32_t)argv;
+    frame->lr = ARM_THUMB_BRANCH_ADDR((uint32_t)uld_sched_task_return);
+    frame->pc = (uint32_t)entry & ~0x1;
+    frame->xpsr = ARM_CORTEX_M_XPSR_T;
+
+    task->sp = (uint32_t *)frame;
+    task->stack_base = stack_base;
+    task->stack_size = stack_size;
+    task->instance = instance;
+    task->state = ULD_SCHED_TASK_STATE_READY;
+    uld_sched_ready_count++;
+
+    if (uld_verbose) {
+        printf("sched: task %d entry [<%p>] fdpic base: %p stack: %p - %p\n",
+                i, entry, (void *)fdpic_base, stack_base,
+                stack_base + stack_size);
+    }
+
+    return i;
+}
+
+uint32_t *uld_sched_switch(uint32_t *sp)
+{
+    struct uld_sched_task *task;
+    int i;
+    int idx;
+
+    if (uld_sched_cur < 0) {
+        uld_sched_idle_sp = sp;
+    } else {
+        uld_sched_task_list[uld_sched_cur].sp = sp;
+    }
+
+    if (uld_sched_lock_count && uld_sched_cur >= 0 &&
+            uld_sched_task_list[uld_sched_cur].state ==
+            ULD_SCHED_TASK_STATE_READY) {
+        return sp;
+    }
+
+    // Round robin starting after the current task, uld only runs when no
+    // task is ready.
+    for (i = 1; i <= ULD_SCHED_TASK_MAX; i++) {
+        idx = (uld_sched_cur + i + ULD_SCHED_TASK_MAX) % ULD_SCHED_TASK_MAX;
+        task = &uld_sched_task_list[idx];
+        if (task->state == ULD_SCHED_TASK_STATE_READY) {
+            uld_sched_cur = idx;
+            // Runtime services apply to the running program.
+            uld_dyn_state.instance = task->instance;
+            return task->sp;
+        }
+    }
+
+    uld_sched_cur = -1;
+    return uld_sched_idle_sp;
+}
+
+void uld_sched_task_exit(int ret)
+{
+    // Still preemptible here.  A lock held by the task is dropped with it.
+    uld_sched_lock_count = 1;
+    if (uld_verbose) {
+        printf("sched: task %d returned %d\n", uld_sched_cur, ret);
+    }
+
+    uld_sched_lock_count = 0;
+    uld_sched_task_list[uld_sched_cur].state = ULD_SCHED_TASK_STATE_DONE;
+    uld_sched_ready_count--;
+    uld_sched_pend_switch();
+}
+
+void uld_sched_systick(void)
+{
+    if (!uld_sched_lock_count) {
+        uld_sched_pend_switch();
+    }
+}
+
+void uld_sched_lock(void)
+{
+    uld_sched_lock_count++;
+}
+
+void uld_sched_unlock(void)
+{
+    if (uld_sched_lock_count) {
+        uld_sched_lock_count--;
+    }
+}
+
+void uld_sched_run(void)
+{
+    if (!uld_sched_ready_count) {
+        return;
+    }
+
+    *(volatile uint32_t *)ARM_CORTEX_M_SYST_RVR_ADDR =
+            ULD_SCHED_TICK_CYCLES - 1;
+    *(volatile uint32_t *)ARM_CORTEX_M_SYST_CVR_ADDR = 0;
+    *(volatile uint32_t *)ARM_CORTEX_M_SYST_CSR_ADDR =
+            ARM_CORTEX_M_SYST_CSR_ENABLE | ARM_CORTEX_M_SYST_CSR_TICKINT |
+            ARM_CORTEX_M_SYST_CSR_CLKSOURCE;
+
+    // First switch saves this context as idle.
+    uld_sched_pend_switch();
+    while (uld_sched_ready_count) {
+        asm volatile ("wfi");
+    }
+
+    *(volatile uint32_t *)ARM_CORTEX_M_SYST_CSR_ADDR = 0;
+    memset(uld_sched_task_list, 0, sizeof(uld_sched_task_list));
+
+    if (uld_verbose) {
+        puts("sched: all tasks returned");
+    }
+}
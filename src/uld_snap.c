@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_dyn.h"
+#include "uld_file.h"
+#include "uld_fs.h"
+#include "uld_mem.h"
+#include "uld_sal.h"
+#include "uld_snap.h"
+#include "util.h"
+
+
+static void uld_snap_span_add(uint8_t **start, uint8_t **end, uint8_t *base,
+        size_t size)
+{
+    if (!base || !size) {
+        return;
+    }
+
+    if (!*start || base < *start) {
+        *start = base;
+    }
+    if (base + size > *end) {
+        *end = base + size;
+    }
+}
+
+static void uld_snap_get_mem_span(const struct uld_dyn_state *ds,
+        uint8_t **base, size_t *size)
+{
+    const struct uld_file *ufile;
+    uint8_t *start = NULL;
+    uint8_t *end = NULL;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        uld_snap_span_add(&start, &end, ufile->membase, ufile->memsz);
+        uld_snap_span_add(&start, &end, ufile->dl_alloc_base,
+                ufile->dl_alloc_size);
+        uld_snap_span_add(&start, &end, ufile->data_image,
+                uld_file_get_data_size(ufile));
+        uld_snap_span_add(&start, &end, ufile->text_image, ufile->text_size);
+        uld_snap_span_add(&start, &end, ufile->heap_base, ufile->heap_size);
+    }
+
+    *base = start;
+    *size = end - start;
+}
+
+static uint32_t uld_snap_calc_crc(const struct uld_snap_hdr *hdr,
+        const void *state, const void *mem)
+{
+    uint32_t crc;
+
+    crc = crc32(&hdr->boot_action,
+            (const uint8_t *)(hdr + 1) - (const uint8_t *)&hdr->boot_action,
+            UTIL_CRC32_INIT);
+    crc = crc32(state, hdr->state_size, crc);
+    if (hdr->mem_size) {
+        crc = crc32(mem, hdr->mem_size, crc);
+    }
+
+    return crc;
+}
+
+int uld_snap_save(void)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_snap_hdr hdr;
+    uint8_t *dest = ULD_SNAP_BASE;
+    size_t total;
+    int was_locked;
+    int ret;
+    int i;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ULD_SNAP_MAGIC;
+    hdr.boot_action = ULD_PSTORE->boot_action;
+    hdr.pstore_crc = uld_crc_calc_pstore();
+    hdr.state = ds;
+    hdr.state_size = sizeof(struct uld_dyn_state);
+    uld_snap_get_mem_span(ds, &hdr.mem_base, &hdr.mem_size);
+    hdr.file_count = ds->file_count;
+    for (i = 0; i < ds->file_count; i++) {
+        hdr.file[i].fse = ds->ufile_list[i].fse;
+        hdr.file[i].crc = ds->ufile_list[i].fse->crc;
+    }
+
+    total = sizeof(hdr) + hdr.state_size + hdr.mem_size;
+    if (total > ULD_SNAP_SIZE) {
+        printf("snapshot: %d bytes exceeds %d\n", (int)total,
+                (int)ULD_SNAP_SIZE);
+        return -1;
+    }
+
+    hdr.crc = uld_snap_calc_crc(&hdr, ds, hdr.mem_base);
+
+    was_locked = cpu_flash_is_locked();
+    if (was_locked) {
+        cpu_flash_unlock();
+    }
+
+    // Header is written last so an interrupted save is never valid.
+    ret = cpu_flash_erase(dest, ULD_SNAP_SIZE);
+    if (!ret) {
+        ret = cpu_flash_write(dest + sizeof(hdr), ds, hdr.state_size);
+    }
+    if (!ret && hdr.mem_size) {
+        ret = cpu_flash_write(dest + sizeof(hdr) + hdr.state_size,
+                hdr.mem_base, hdr.mem_size);
+    }
+    if (!ret) {
+        ret = cpu_flash_write(dest, &hdr, sizeof(hdr));
+    }
+
+    if (was_locked) {
+        cpu_flash_lock();
+    }
+
+    if (!ret) {
+        printf("snapshot saved: %d bytes mem: 0x%p - 0x%p\n", (int)total,
+                hdr.mem_base, hdr.mem_base + hdr.mem_size);
+    }
+
+    return ret;
+}
+
+int uld_snap_restore(const struct uld_fs_entry *exec_fse)
+{
+    const struct uld_snap_hdr *hdr;
+    const struct uld_dyn_state *snap_ds;
+    const uint8_t *src;
+    int i;
+
+    hdr = (const struct uld_snap_hdr *)ULD_SNAP_BASE;
+    if (hdr->magic != ULD_SNAP_MAGIC ||
+            hdr->boot_action != ULD_PSTORE->boot_action ||
+            hdr->state != &uld_dyn_state ||
+            hdr->state_size != sizeof(struct uld_dyn_state) ||
+            hdr->file_count <= 0 || hdr->file_count > ULD_DYN_FILE_MAX ||
+            sizeof(*hdr) + hdr->state_size + hdr->mem_size > ULD_SNAP_SIZE) {
+        return -1;
+    }
+
+    if (hdr->pstore_crc != uld_crc_calc_pstore()) {
+        printf("snapshot: preload or memory placement changed\n");
+        return -1;
+    }
+
+    // Files must not have changed or moved since the snapshot was taken.
+    for (i = 0; i < hdr->file_count; i++) {
+        if (!uld_fs_has_file(uld_fs_get_fst_head(), hdr->file[i].fse) ||
+                hdr->file[i].fse->crc != hdr->file[i].crc) {
+            printf("snapshot: module set changed\n");
+            return -1;
+        }
+    }
+
+    src = (const uint8_t *)(hdr + 1);
+    snap_ds = (const struct uld_dyn_state *)src;
+    if (snap_ds->ufile_list[snap_ds->exec_idx].fse != exec_fse) {
+        return -1;
+    }
+
+    if (hdr->crc != uld_snap_calc_crc(hdr, src, src + hdr->state_size)) {
+        printf("snapshot: crc mismatch\n");
+        return -1;
+    }
+
+    memcpy(&uld_dyn_state, src, hdr->state_size);
+    if (uld_dyn_reserve_file_list(uld_dyn_state.ufile_list,
+            uld_dyn_state.file_count)) {
+        printf("snapshot: module memory in use\n");
+        memset(&uld_dyn_state, 0, sizeof(struct uld_dyn_state));
+        return -1;
+    }
+
+    if (hdr->mem_size) {
+        memcpy(hdr->mem_base, src + hdr->state_size, hdr->mem_size);
+    }
+
+    printf("snapshot restored: %d files mem: 0x%p - 0x%p\n",
+            hdr->file_count, hdr->mem_base, hdr->mem_base + hdr->mem_size);
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "cpu.h"
+#include "uld_dyn.h"
+#include "uld_irq.h"
+#include "uld_svc.h"
+
+
+void uld_svc_init(void)
+{
+#ifdef CONFIG_CPU_VEC_IN_MEM
+    cpu_memvec_set(ARM_CORTEX_M_EXC_SVC, vector_svc);
+#endif
+}
+
+uint32_t uld_svc_dispatch(unsigned int num, struct uld_svc_frame *frame)
+{
+    switch (num) {
+    case ULD_SVC_DLOPEN:
+        return (uint32_t)uld_dyn_dlopen((const char *)frame->r0);
+
+    case ULD_SVC_DLSYM:
+        return (uint32_t)uld_dyn_dlsym((void *)frame->r0,
+                (const char *)frame->r1);
+
+    case ULD_SVC_DLCLOSE:
+        return (uint32_t)uld_dyn_dlclose((void *)frame->r0);
+
+    case ULD_SVC_MODULE_INIT:
+        return (uint32_t)uld_dyn_module_init((const char *)frame->r0);
+
+    case ULD_SVC_SWAP:
+        return (uint32_t)uld_dyn_swap((const char *)frame->r0,
+                (const char *)frame->r1);
+
+    case ULD_SVC_PATCH:
+        return (uint32_t)uld_dyn_patch((const char *)frame->r0,
+                (const char *)frame->r1);
+
+    case ULD_SVC_OVERLAY:
+        return (uint32_t)uld_dyn_overlay((const char *)frame->r0);
+
+    case ULD_SVC_IRQ:
+        return (uint32_t)uld_irq_register((int)frame->r0,
+                (const void *)frame->r1);
+
+    default:
+        printf("invalid svc: %u from [<%p>]\n", num, (void *)frame->pc);
+        swbkpt();
+        break;
+    }
+
+    return (uint32_t)-1;
+}
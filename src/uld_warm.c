@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2016, 2017 Joe Vernaci
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*/
+
+#include "uld.h"
+#include "uld_dyn.h"
+#include "uld_file.h"
+#include "uld_fs.h"
+#include "uld_mem.h"
+#include "uld_sal.h"
+#include "uld_warm.h"
+#include "util.h"
+
+
+#ifdef ULD_WARM_RESET
+
+static struct uld_warm_desc uld_warm_desc
+        __section(".bss.noinit.uld_warm_desc");
+
+
+static uint32_t uld_warm_crc_sec(const struct uld_section *sec, uint32_t crc)
+{
+    if (!sec) {
+        return crc;
+    }
+
+    return crc32(sec->adjusted_vma, sec->shdr->sh_size, crc);
+}
+
+static uint32_t uld_warm_calc_state_crc(const struct uld_warm_desc *desc)
+{
+    uint32_t crc;
+
+    crc = crc32(&desc->boot_action,
+            (const uint8_t *)(desc + 1) - (const uint8_t *)&desc->boot_action,
+            UTIL_CRC32_INIT);
+
+    return crc32(&uld_dyn_state, sizeof(struct uld_dyn_state), crc);
+}
+
+static uint32_t uld_warm_calc_mem_crc(const struct uld_dyn_state *ds)
+{
+    const struct uld_file *ufile;
+    uint32_t crc = UTIL_CRC32_INIT;
+    int i;
+
+    for (i = 0; i < ds->file_count; i++) {
+        ufile = &ds->ufile_list[i];
+        crc = uld_warm_crc_sec(uld_file_get_sec_got(ufile), crc);
+        crc = uld_warm_crc_sec(uld_file_get_sec_got_plt(ufile), crc);
+        if (ufile->data_image) {
+            crc = crc32(ufile->data_image, uld_file_get_data_size(ufile),
+                    crc);
+        }
+    }
+
+    return crc;
+}
+
+// On failure the module set is not retained (see uld_warm_update).
+void uld_warm_save_data(struct uld_file *ufile)
+{
+    const struct uld_section *data = uld_file_get_sec_data(ufile);
+    size_t size = uld_file_get_data_size(ufile);
+
+    if (!size) {
+        return;
+    }
+
+    ufile->data_image = uld_mem_alloc(size);
+    if (!ufile->data_image) {
+        printf("warm: no memory for %s .data image\n", ufile->fse->name);
+        return;
+    }
+
+    memcpy(ufile->data_image, data->adjusted_vma, size);
+}
+
+void uld_warm_free_data(struct uld_file *ufile)
+{
+    if (!ufile->data_image) {
+        return;
+    }
+
+    uld_mem_free(ufile->data_image, uld_file_get_data_size(ufile));
+    ufile->data_image = NULL;
+}
+
+void uld_warm_update(void)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_warm_desc *desc = &uld_warm_desc;
+    int i;
+
+    // Invalidate first, magic is set last.
+    desc->magic = 0;
+    // uld_warm_restore only recovers a set started by uld_dyn_exec_fse.
+    if (ds->program_count != 1) {
+        return;
+    }
+    memset(desc->file, 0, sizeof(desc->file));
+    desc->boot_action = ULD_PSTORE->boot_action;
+    desc->pstore_crc = uld_crc_calc_pstore();
+    desc->file_count = ds->file_count;
+    for (i = 0; i < ds->file_count; i++) {
+        // Without a .data image the set can not be restored.
+        if (!ds->ufile_list[i].data_image &&
+                uld_file_get_data_size(&ds->ufile_list[i])) {
+            return;
+        }
+        desc->file[i].fse = ds->ufile_list[i].fse;
+        desc->file[i].crc = ds->ufile_list[i].fse->crc;
+    }
+
+    desc->mem_crc = uld_warm_calc_mem_crc(ds);
+    desc->state_crc = uld_warm_calc_state_crc(desc);
+    desc->magic = ULD_WARM_MAGIC;
+}
+
+static void uld_warm_reload_data(const struct uld_file *ufile)
+{
+    const struct uld_section *data = uld_file_get_sec_data(ufile);
+    const struct uld_section *bss = uld_file_get_sec_bss(ufile);
+
+    if (data && ufile->data_image) {
+        memcpy((void *)data->adjusted_vma, ufile->data_image,
+                data->shdr->sh_size);
+    }
+    if (bss) {
+        memset((void *)bss->adjusted_vma, 0, bss->shdr->sh_size);
+    }
+}
+
+int uld_warm_restore(const struct uld_fs_entry *exec_fse)
+{
+    struct uld_dyn_state *ds = &uld_dyn_state;
+    struct uld_warm_desc *desc = &uld_warm_desc;
+    int i;
+
+    if (desc->magic != ULD_WARM_MAGIC ||
+            desc->boot_action != ULD_PSTORE->boot_action ||
+            desc->file_count <= 0 || desc->file_count > ULD_DYN_FILE_MAX) {
+        return -1;
+    }
+
+    if (desc->state_crc != uld_warm_calc_state_crc(desc) ||
+            ds->file_count != desc->file_count ||
+            ds->exec_idx < 0 || ds->exec_idx >= ds->file_count ||
+            ds->ufile_list[ds->exec_idx].fse != exec_fse) {
+        printf("warm: state invalid\n");
+        desc->magic = 0;
+        return -1;
+    }
+
+    if (desc->pstore_crc != uld_crc_calc_pstore()) {
+        printf("warm: preload or memory placement changed\n");
+        desc->magic = 0;
+        return -1;
+    }
+
+    // Files must not have changed or moved since they were linked.
+    for (i = 0; i < desc->file_count; i++) {
+        if (!uld_fs_has_file(uld_fs_get_fst_head(), desc->file[i].fse) ||
+                desc->file[i].fse->crc != desc->file[i].crc ||
+                ds->ufile_list[i].fse != desc->file[i].fse) {
+            printf("warm: module set changed\n");
+            desc->magic = 0;
+            return -1;
+        }
+    }
+
+    if (desc->mem_crc != uld_warm_calc_mem_crc(ds)) {
+        printf("warm: module memory corrupt\n");
+        desc->magic = 0;
+        return -1;
+    }
+
+    if (uld_dyn_reserve_file_list(ds->ufile_list, ds->file_count)) {
+        printf("warm: module memory in use\n");
+        desc->magic = 0;
+        return -1;
+    }
+
+    for (i = 0; i < ds->file_count; i++) {
+        uld_warm_reload_data(&ds->ufile_list[i]);
+        uld_dyn_zero_dl_objects(i);
+    }
+
+    printf("warm reset: %d files retained\n", ds->file_count);
+
+    return 0;
+}
+
+#endif  // ULD_WARM_RESET